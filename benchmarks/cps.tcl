@@ -89,6 +89,16 @@ cps {baseObj stateless;base2 stateless}
 base2 destroy
 baseObj destroy
 
+puts "Method invokation across many instances microbenchmark"
+set objs {}
+for {set i 0} {$i < 100} {incr i} {
+    lappend objs [base new]
+}
+cps {foreach o $objs {$o stateless}}
+cps {foreach o $objs {$o stateful}}
+foreach o $objs {$o destroy}
+unset objs
+
 puts "Object creation/deletion microbenchmarks"
 cps {[base new] destroy}
 cps {[base create obj] destroy}
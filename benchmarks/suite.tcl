@@ -0,0 +1,561 @@
+# suite.tcl --
+#
+#	Structured benchmark suite for TclOO. Each scenario exercises one part
+#	of the object system and is timed with the same calibrated [time] loop
+#	as cps.tcl; the results can be written as text, JSON or CSV, saved as
+#	a baseline, and compared against a previously saved baseline.
+#
+# Usage:
+#	tclsh suite.tcl ?option value ...? ?iterations?
+#
+#	-format text|json|csv	How to write the results (default: text).
+#	-match pattern		Only run scenarios whose names match.
+#	-iterations n		Run each scenario exactly n times instead of
+#				calibrating; a bare number means the same.
+#	-calibration file	Read the number of iterations of each scenario
+#				from file, calibrating (and writing the file)
+#				if it does not exist. Keeps runs comparable.
+#	-save file		Save the results as a baseline.
+#	-compare file		Compare the results against a saved baseline,
+#				exiting with status 1 on regressions.
+#	-threshold percent	How much slower counts as a regression when
+#				comparing (default: 10).
+
+set auto_path "[list [pwd]] $auto_path"
+package require TclOO
+
+namespace eval bench {
+    variable scenarios {}
+    variable options {
+	-format text -match * -iterations 0 -calibration {} -save {}
+	-compare {} -threshold 10
+    }
+}
+
+# ----------------------------------------------------------------------
+# bench::cps --
+#	The cps algorithm from cps.tcl, returning its findings instead of
+#	printing them. Works out how many iterations of the script take
+#	around a second (unless told how many to do) and returns a dict with
+#	the number of iterations run and the time per iteration in
+#	microseconds.
+#
+proc bench::cps {script {iters 0}} {
+    # Eat the script compilation costs
+    uplevel 1 [list time $script]
+
+    if {$iters <= 0} {
+	# Have a guess at how many iterations to run for around a second
+	set s [uplevel 1 [list time $script 5]]
+	set iters [expr {max(1, round(1.1/([lindex $s 0]/1e6)))}]
+
+	# The main timing run; only use the run if it was for at least a
+	# second, otherwise increase the number of iterations and try again.
+	while 1 {
+	    set s [uplevel 1 [list time $script $iters]]
+	    if {[lindex $s 0]*$iters >= 1e6} {
+		break
+	    }
+	    incr iters $iters
+	}
+    } else {
+	set s [uplevel 1 [list time $script $iters]]
+    }
+    return [dict create iterations $iters usec [lindex $s 0]]
+}
+
+# ----------------------------------------------------------------------
+# bench::scenario --
+#	Declares a scenario. The setup and cleanup scripts are run (in the
+#	global namespace) outside the timed region; the body is what is timed.
+#
+proc bench::scenario {name setup body {cleanup {}}} {
+    variable scenarios
+    lappend scenarios $name $setup $body $cleanup
+}
+
+# ----------------------------------------------------------------------
+# The scenarios themselves, grouped by the part of TclOO that they exercise.
+#
+
+oo::class create ::bench::Base {
+    variable x
+    constructor {} {
+	set x 1
+    }
+    method empty {} { }
+    method stateful {} {
+	set x [expr {!$x}]
+    }
+    method stateless {} {
+	set local 1
+	expr {!$local}
+    }
+    method viaMy {} {
+	my empty
+    }
+    method declaredVar {} {
+	incr x
+    }
+    method varCommand {} {
+	variable y
+	incr y
+    }
+    method varName {} {
+	set [my varname z] 1
+    }
+    method fwd {} {
+	my empty
+    }
+    forward forwarded my empty
+    method unknown {args} { }
+    method fiveArgs {a b c {d 4} {e 5}} { }
+    method restArgs {a b args} { }
+}
+
+bench::scenario call.empty {
+    set o [bench::Base new]
+} {
+    $o empty
+} {
+    $o destroy
+}
+bench::scenario call.stateless {
+    set o [bench::Base new]
+} {
+    $o stateless
+} {
+    $o destroy
+}
+bench::scenario call.args {
+    set o [bench::Base new]
+} {
+    $o fiveArgs 1 2 3
+    $o fiveArgs 1 2 3 4 5
+} {
+    $o destroy
+}
+bench::scenario call.restArgs {
+    set o [bench::Base new]
+} {
+    $o restArgs 1 2 3 4 5 6
+} {
+    $o destroy
+}
+bench::scenario next.args {
+    oo::class create bench::ArgsSub {
+	superclass bench::Base
+	method fiveArgs {a b c {d 4} {e 5}} {next $a $b $c $d $e}
+    }
+    set o [bench::ArgsSub new]
+} {
+    $o fiveArgs 1 2 3
+} {
+    bench::ArgsSub destroy
+}
+bench::scenario call.manyInstances {
+    set objs {}
+    for {set i 0} {$i < 100} {incr i} {
+	lappend objs [bench::Base new]
+    }
+} {
+    foreach o $objs {$o stateless}
+} {
+    foreach o $objs {$o destroy}
+}
+bench::scenario call.unknown {
+    set o [bench::Base new]
+} {
+    $o noSuchMethod
+} {
+    $o destroy
+}
+bench::scenario my.call {
+    set o [bench::Base new]
+} {
+    $o viaMy
+} {
+    $o destroy
+}
+bench::scenario var.declared {
+    set o [bench::Base new]
+} {
+    $o declaredVar
+} {
+    $o destroy
+}
+bench::scenario var.command {
+    set o [bench::Base new]
+} {
+    $o varCommand
+} {
+    $o destroy
+}
+bench::scenario var.varname {
+    set o [bench::Base new]
+} {
+    $o varName
+} {
+    $o destroy
+}
+bench::scenario forward.call {
+    set o [bench::Base new]
+} {
+    $o forwarded
+} {
+    $o destroy
+}
+bench::scenario next.deep {
+    set cls bench::Base
+    for {set i 0} {$i < 8} {incr i} {
+	set cls [oo::class create bench::Deep$i [list superclass $cls]]
+	oo::define $cls method empty {} {next}
+    }
+    set o [$cls new]
+} {
+    $o empty
+} {
+    $o destroy
+    bench::Deep0 destroy
+}
+bench::scenario filter.class {
+    oo::class create bench::Filtered {
+	superclass bench::Base
+	method Audit args {next {*}$args}
+	filter Audit
+    }
+    set o [bench::Filtered new]
+} {
+    $o empty
+} {
+    bench::Filtered destroy
+}
+bench::scenario filter.object {
+    set o [bench::Base new]
+    oo::objdefine $o {
+	method Audit args {next {*}$args}
+	filter Audit
+    }
+} {
+    $o empty
+} {
+    $o destroy
+}
+bench::scenario filter.selfCall {
+    oo::class create bench::Filtered {
+	superclass bench::Base
+	method Audit args {my stateless; next {*}$args}
+	filter Audit
+    }
+    set o [bench::Filtered new]
+} {
+    $o empty
+} {
+    bench::Filtered destroy
+}
+bench::scenario mixin.call {
+    oo::class create bench::Mixin {
+	method empty {} {next}
+    }
+    oo::class create bench::Mixed {
+	superclass bench::Base
+	mixin bench::Mixin
+    }
+    set o [bench::Mixed new]
+} {
+    $o empty
+} {
+    bench::Mixed destroy
+    bench::Mixin destroy
+}
+bench::scenario create.new {} {
+    [bench::Base new] destroy
+}
+bench::scenario create.named {} {
+    [bench::Base create ::bench::obj] destroy
+}
+bench::scenario create.pooled {
+    oo::class create bench::Pooled {superclass bench::Base; pool 8}
+} {
+    [bench::Pooled new] destroy
+} {
+    bench::Pooled destroy
+}
+bench::scenario copy.object {
+    set o [bench::Base new]
+} {
+    [oo::copy $o] destroy
+} {
+    $o destroy
+}
+bench::scenario define.churn {
+    oo::class create bench::Churn {superclass bench::Base}
+    set o [bench::Churn new]
+} {
+    oo::define bench::Churn method tmp {} {}
+    $o tmp
+    oo::define bench::Churn deletemethod tmp
+    $o empty
+} {
+    bench::Churn destroy
+}
+bench::scenario info.instancesPrefix {
+    oo::class create bench::Many {superclass bench::Base}
+    namespace eval ::bench::sessions {}
+    for {set i 0} {$i < 10000} {incr i} {
+	bench::Many create ::bench::sessions::user$i
+    }
+} {
+    info class instances bench::Many ::bench::sessions::user42*
+} {
+    bench::Many destroy
+    namespace delete ::bench::sessions
+}
+bench::scenario info.instancesCount {
+    oo::class create bench::Many {superclass bench::Base}
+    namespace eval ::bench::sessions {}
+    for {set i 0} {$i < 10000} {incr i} {
+	bench::Many create ::bench::sessions::user$i
+    }
+} {
+    info class instances bench::Many -count -prefix ::bench::sessions::user4
+} {
+    bench::Many destroy
+    namespace delete ::bench::sessions
+}
+bench::scenario info.instancesAll {
+    oo::class create bench::Many {superclass bench::Base}
+    oo::class create bench::More {superclass bench::Many}
+    for {set i 0} {$i < 5000} {incr i} {
+	bench::Many new
+	bench::More new
+    }
+} {
+    info class instances bench::Many -all -count
+} {
+    bench::Many destroy
+}
+bench::scenario info.call {
+    set o [bench::Base new]
+} {
+    info object call $o stateless
+} {
+    $o destroy
+}
+bench::scenario teardown.class {} {
+    oo::class create bench::Doomed {superclass bench::Base}
+    for {set i 0} {$i < 100} {incr i} {
+	bench::Doomed new
+    }
+    bench::Doomed destroy
+}
+
+# ----------------------------------------------------------------------
+# Support for reading and writing the files used for calibration and
+# baselines. Both are simple dictionaries mapping scenario names to values.
+#
+
+proc bench::readDict {filename} {
+    set f [open $filename]
+    set data [read $f]
+    close $f
+    return [dict create {*}$data]
+}
+
+proc bench::writeDict {filename dict} {
+    set f [open $filename w]
+    dict for {key value} $dict {
+	puts $f [list $key $value]
+    }
+    close $f
+}
+
+# ----------------------------------------------------------------------
+# bench::run --
+#	Runs the selected scenarios, returning a list of result dictionaries.
+#
+proc bench::run {} {
+    variable scenarios
+    variable options
+    set calibration {}
+    set calibrating 0
+    set file [dict get $options -calibration]
+    if {$file ne ""} {
+	if {[file exists $file]} {
+	    set calibration [readDict $file]
+	} else {
+	    set calibrating 1
+	}
+    }
+
+    set results {}
+    foreach {name setup body cleanup} $scenarios {
+	if {![string match [dict get $options -match] $name]} {
+	    continue
+	}
+	set iters [dict get $options -iterations]
+	if {[dict exists $calibration $name]} {
+	    set iters [dict get $calibration $name]
+	}
+	uplevel #0 $setup
+	set code [catch {uplevel #0 [list bench::cps $body $iters]} r opts]
+	uplevel #0 $cleanup
+	if {$code} {
+	    return -options $opts $r
+	}
+	if {$calibrating} {
+	    dict set calibration $name [dict get $r iterations]
+	}
+	set usec [dict get $r usec]
+	lappend results [dict create name $name \
+		iterations [dict get $r iterations] usec $usec \
+		cps [expr {$usec > 0 ? round(1e6/$usec) : 0}]]
+    }
+    if {$calibrating} {
+	writeDict $file $calibration
+    }
+    return $results
+}
+
+# ----------------------------------------------------------------------
+# bench::compare --
+#	Annotates results with how they compare against a baseline, returning
+#	the annotated results and the number of regressions.
+#
+proc bench::compare {results filename threshold} {
+    set baseline [readDict $filename]
+    set out {}
+    set regressions 0
+    foreach r $results {
+	set name [dict get $r name]
+	if {[dict exists $baseline $name] && [dict get $baseline $name] > 0} {
+	    set old [dict get $baseline $name]
+	    set change [expr {
+		100.0 * ([dict get $r usec] - $old) / $old
+	    }]
+	    dict set r baseline $old
+	    dict set r change [format %.1f $change]
+	    if {$change > $threshold} {
+		dict set r regression 1
+		incr regressions
+	    } else {
+		dict set r regression 0
+	    }
+	}
+	lappend out $r
+    }
+    return [list $out $regressions]
+}
+
+# ----------------------------------------------------------------------
+# Output formatting.
+#
+
+proc bench::formatText {results} {
+    set lines {}
+    foreach r $results {
+	set line [format "%-22s %12d calls/s %10.3f us/call" \
+		[dict get $r name] [dict get $r cps] [dict get $r usec]]
+	if {[dict exists $r change]} {
+	    append line [format " %+7.1f%%" [dict get $r change]]
+	    if {[dict get $r regression]} {
+		append line "  REGRESSION"
+	    }
+	}
+	lappend lines $line
+    }
+    return [join $lines \n]
+}
+
+proc bench::formatCsv {results} {
+    set lines [list "name,iterations,usec,cps,baseline,change,regression"]
+    foreach r $results {
+	set row {}
+	foreach key {name iterations usec cps baseline change regression} {
+	    lappend row [expr {[dict exists $r $key] ? [dict get $r $key] : ""}]
+	}
+	lappend lines [join $row ,]
+    }
+    return [join $lines \n]
+}
+
+proc bench::formatJson {results} {
+    set items {}
+    foreach r $results {
+	set fields {}
+	dict for {key value} $r {
+	    if {$key eq "name"} {
+		set value "\"[string map {\\ \\\\ \" \\\"} $value]\""
+	    } elseif {$key eq "regression"} {
+		set value [expr {$value ? "true" : "false"}]
+	    }
+	    lappend fields "\"$key\": $value"
+	}
+	lappend items "    \{[join $fields {, }]\}"
+    }
+    return "\{\n  \"tcloo\": \"[package provide TclOO]\",\n  \"results\": \[\n[join $items ,\n]\n  \]\n\}"
+}
+
+# ----------------------------------------------------------------------
+# bench::main --
+#	Parses the command line, runs the scenarios and reports on them.
+#
+proc bench::main {argv} {
+    variable options
+    while {[llength $argv]} {
+	set argv [lassign $argv opt]
+	if {[string is integer -strict $opt]} {
+	    # A bare number is a fixed iteration count, as passed by the
+	    # "benchmarks" makefile target.
+	    dict set options -iterations $opt
+	    continue
+	}
+	if {![dict exists $options $opt]} {
+	    return -code error "unknown option \"$opt\": must be\
+		    [join [dict keys $options] {, }]"
+	}
+	if {![llength $argv]} {
+	    return -code error "missing value for option \"$opt\""
+	}
+	set argv [lassign $argv value]
+	dict set options $opt $value
+    }
+    if {[dict get $options -format] ni {text json csv}} {
+	return -code error "bad format \"[dict get $options -format]\":\
+		must be text, json or csv"
+    }
+
+    set results [run]
+    set regressions 0
+    if {[dict get $options -compare] ne ""} {
+	lassign [compare $results [dict get $options -compare] \
+		[dict get $options -threshold]] results regressions
+    }
+    if {[dict get $options -save] ne ""} {
+	set baseline {}
+	foreach r $results {
+	    dict set baseline [dict get $r name] [dict get $r usec]
+	}
+	writeDict [dict get $options -save] $baseline
+    }
+
+    switch [dict get $options -format] {
+	text {
+	    puts "TclOO [package provide TclOO] benchmark suite"
+	    puts [formatText $results]
+	}
+	json {puts [formatJson $results]}
+	csv  {puts [formatCsv $results]}
+    }
+    return $regressions
+}
+
+if {[catch {bench::main $argv} regressions]} {
+    puts stderr $regressions
+    exit 2
+}
+exit [expr {$regressions > 0}]
+
+# Local Variables:
+# mode: tcl
+# End:
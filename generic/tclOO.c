@@ -30,6 +30,7 @@ static const struct {
     {"export", TclOODefineExportObjCmd, 0},
     {"forward", TclOODefineForwardObjCmd, 0},
     {"method", TclOODefineMethodObjCmd, 0},
+    {"pool", TclOODefinePoolObjCmd, 0},
     {"renamemethod", TclOODefineRenameMethodObjCmd, 0},
     {"self", TclOODefineSelfObjCmd, 0},
     {"unexport", TclOODefineUnexportObjCmd, 0},
@@ -66,18 +67,38 @@ static int		CloneClassMethod(Tcl_Interp *interp, Class *clsPtr,
 			    Method **newMPtrPtr);
 static int		CloneObjectMethod(Tcl_Interp *interp, Object *oPtr,
 			    Method *mPtr, Tcl_Obj *namePtr);
+static int		CmpInt(const void *ptr1, const void *ptr2);
+static void		ComputeAncestors(Class *clsPtr);
 static void		DeletedDefineNamespace(ClientData clientData);
 static void		DeletedObjdefNamespace(ClientData clientData);
 static void		DeletedHelpersNamespace(ClientData clientData);
+static void		DrainPool(Class *clsPtr, int keep);
+static int		ForeachInstanceBelow(Class *rootPtr, Class *clsPtr,
+			    Tcl_ClassInstanceProc *proc,
+			    ClientData clientData);
+static void		ForgetWeakRef(Object *oPtr);
 static int		InitFoundation(Tcl_Interp *interp);
+static int		MapMethodName(Tcl_Interp *interp, Object *oPtr,
+			    Tcl_Obj *methodNameObj, Tcl_Obj **mappedObjPtr,
+			    Class **startClsPtr);
+static void		ReleaseMappedNames(Object *oPtr);
 static void		KillFoundation(ClientData clientData,
 			    Tcl_Interp *interp);
+static void		MakeObjectCommand(Tcl_Interp *interp, Object *oPtr,
+			    const char *nameStr);
 static void		MyDeleted(ClientData clientData);
 static void		ObjectNamespaceDeleted(ClientData clientData);
 static void		ObjectRenamedTrace(ClientData clientData,
 			    Tcl_Interp *interp, const char *oldName,
 			    const char *newName, int flags);
+static int		PoolObject(Tcl_Interp *interp, Object *oPtr);
 static void		ReleaseClassContents(Tcl_Interp *interp,Object *oPtr);
+static void		SettleNamespace(Object *oPtr);
+static int		ResetObjectVariables(Tcl_Interp *interp,
+			    Object *oPtr);
+static int		ShellIsClean(Object *oPtr);
+static Object *		TakeFromPool(Tcl_Interp *interp, Class *clsPtr,
+			    const char *nameStr);
 
 static int		PublicObjectCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
@@ -321,16 +342,25 @@ InitFoundation(
 	    DeletedHelpersNamespace);
     fPtr->epoch = 0;
     fPtr->tsdPtr = tsdPtr;
+    Tcl_InitHashTable(&fPtr->shapeTable, TCL_STRING_KEYS);
+    Tcl_InitHashTable(&fPtr->weakRefTable, TCL_ONE_WORD_KEYS);
     fPtr->unknownMethodNameObj = Tcl_NewStringObj("unknown", -1);
     fPtr->constructorName = Tcl_NewStringObj("<constructor>", -1);
     fPtr->destructorName = Tcl_NewStringObj("<destructor>", -1);
     fPtr->clonedName = Tcl_NewStringObj("<cloned>", -1);
     fPtr->defineName = Tcl_NewStringObj("::oo::define", -1);
+    fPtr->filterLiteral = Tcl_NewStringObj("filter", -1);
+    fPtr->methodLiteral = Tcl_NewStringObj("method", -1);
+    fPtr->objectLiteral = Tcl_NewStringObj("object", -1);
+    fPtr->byteCodeTypePtr = Tcl_GetObjType("bytecode");
     Tcl_IncrRefCount(fPtr->unknownMethodNameObj);
     Tcl_IncrRefCount(fPtr->constructorName);
     Tcl_IncrRefCount(fPtr->destructorName);
     Tcl_IncrRefCount(fPtr->clonedName);
     Tcl_IncrRefCount(fPtr->defineName);
+    Tcl_IncrRefCount(fPtr->filterLiteral);
+    Tcl_IncrRefCount(fPtr->methodLiteral);
+    Tcl_IncrRefCount(fPtr->objectLiteral);
     Tcl_CreateObjCommand(interp, "::oo::UnknownDefinition",
 	    TclOOUnknownDefinition, NULL, NULL);
     namePtr = Tcl_NewStringObj("::oo::UnknownDefinition", -1);
@@ -379,6 +409,10 @@ InitFoundation(
     fPtr->objectCls->superclasses.list = NULL;
     fPtr->classCls->thisPtr->selfCls = fPtr->classCls;
     fPtr->classCls->thisPtr->flags |= ROOT_CLASS;
+    fPtr->nsSetupEpoch = ((Namespace *)
+	    fPtr->classCls->thisPtr->namespacePtr)->resolverEpoch;
+    SettleNamespace(fPtr->objectCls->thisPtr);
+    SettleNamespace(fPtr->classCls->thisPtr);
     fPtr->classCls->flags |= ROOT_CLASS;
     TclOOAddToInstances(fPtr->objectCls->thisPtr, fPtr->classCls);
     TclOOAddToInstances(fPtr->classCls->thisPtr, fPtr->classCls);
@@ -437,6 +471,15 @@ InitFoundation(
     Tcl_CreateObjCommand(interp, "::oo::objdefine", TclOOObjDefObjCmd, NULL,
 	    NULL);
     Tcl_CreateObjCommand(interp, "::oo::copy", TclOOCopyObjectCmd, NULL,NULL);
+    Tcl_CreateObjCommand(interp, "::oo::isa", TclOOIsAObjCmd, NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::oo::weakref", TclOOWeakRefObjCmd, NULL,
+	    NULL);
+    Tcl_CreateObjCommand(interp, "::oo::precompile", TclOOPrecompileObjCmd,
+	    NULL, NULL);
+    Tcl_CreateObjCommand(interp, "::oo::profile", TclOOProfileObjCmd, NULL,
+	    NULL);
+    Tcl_CreateObjCommand(interp, "::oo::stats", TclOOStatsObjCmd, NULL,
+	    NULL);
     TclOOInitInfo(interp);
 
     /*
@@ -518,6 +561,14 @@ KillFoundation(
     Tcl_DecrRefCount(fPtr->destructorName);
     Tcl_DecrRefCount(fPtr->clonedName);
     Tcl_DecrRefCount(fPtr->defineName);
+    Tcl_DecrRefCount(fPtr->filterLiteral);
+    Tcl_DecrRefCount(fPtr->methodLiteral);
+    Tcl_DecrRefCount(fPtr->objectLiteral);
+    if (fPtr->profilePtr != NULL) {
+	TclOODeleteProfileData(fPtr->profilePtr);
+    }
+    Tcl_DeleteHashTable(&fPtr->shapeTable);
+    Tcl_DeleteHashTable(&fPtr->weakRefTable);
     ckfree((char *) fPtr);
 }
 
@@ -547,7 +598,6 @@ AllocObject(
 				 * a namespace that already exists, the effect
 				 * will be the same as if this was NULL. */
 {
-    Tcl_DString buffer;
     Object *oPtr;
     int creationEpoch;
 
@@ -614,41 +664,16 @@ AllocObject(
     oPtr->fPtr = fPtr;
     oPtr->selfCls = fPtr->objectCls;
     oPtr->creationEpoch = creationEpoch;
+    fPtr->numObjects++;
     oPtr->refCount = 1;
     oPtr->flags = USE_CLASS_CACHE;
 
     /*
-     * Finally, create the object commands and initialize the trace on the
-     * public command (so that the object structures are deleted when the
-     * command is deleted).
+     * Finally, create the object commands.
      */
 
-    if (nameStr) {
-	if (nameStr[0] != ':' || nameStr[1] != ':') {
-	    Tcl_DStringInit(&buffer);
-	    Tcl_DStringAppend(&buffer,
-		    Tcl_GetCurrentNamespace(interp)->fullName, -1);
-	    Tcl_DStringAppend(&buffer, "::", 2);
-	    Tcl_DStringAppend(&buffer, nameStr, -1);
-	    oPtr->command = Tcl_CreateObjCommand(interp,
-		    Tcl_DStringValue(&buffer), PublicObjectCmd, oPtr, NULL);
-	    Tcl_DStringFree(&buffer);
-	} else {
-	    oPtr->command = Tcl_CreateObjCommand(interp, nameStr,
-		    PublicObjectCmd, oPtr, NULL);
-	}
-    } else {
-	oPtr->command = Tcl_CreateObjCommand(interp,
-		oPtr->namespacePtr->fullName, PublicObjectCmd, oPtr, NULL);
-    }
-
-    /*
-     * We use a trace because we need to know about renames as well as
-     * deletes.
-     */
-
-    Tcl_TraceCommand(interp, TclGetString(TclOOObjectName(interp, oPtr)),
-	    TCL_TRACE_RENAME|TCL_TRACE_DELETE, ObjectRenamedTrace, oPtr);
+    MakeObjectCommand(interp, oPtr,
+	    nameStr ? nameStr : oPtr->namespacePtr->fullName);
 
     /*
      * Access the namespace command table directly when creating "my" to avoid
@@ -676,6 +701,82 @@ AllocObject(
     return oPtr;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * SettleNamespace --
+ *
+ *	Called once TclOO has finished setting up the namespace of an object
+ *	or class, whether new or taken from a pool. Each step of setting up a
+ *	namespace (installing the resolvers, setting the path) moves its
+ *	resolution epoch on, and classes take more steps than plain objects.
+ *	So that bytecode compiled in a class's namespace is accepted by the
+ *	bytecode engine when run in the namespaces of the class's instances
+ *	(see PushMethodCallFrame), every namespace is brought forward to the
+ *	epoch that the namespace of oo::class reached. The epoch only ever
+ *	moves forward, to a value that the namespace has never had, so at
+ *	worst this makes bytecode compiled against the namespace out of date,
+ *	as any advance made by Tcl itself would. The epoch is then remembered,
+ *	so that later shadowing of commands in the namespace can be spotted.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+SettleNamespace(
+    Object *oPtr)		/* The object whose namespace is set up. */
+{
+    Namespace *nsPtr = (Namespace *) oPtr->namespacePtr;
+
+    if (nsPtr->resolverEpoch < oPtr->fPtr->nsSetupEpoch) {
+	nsPtr->resolverEpoch = oPtr->fPtr->nsSetupEpoch;
+    }
+    oPtr->nsResolverEpoch = nsPtr->resolverEpoch;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * MakeObjectCommand --
+ *
+ *	Create the public command of an object and initialize the trace on it
+ *	(so that the object structures are deleted when the command is
+ *	deleted). Relative names are resolved against the current namespace.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+MakeObjectCommand(
+    Tcl_Interp *interp,		/* Interpreter to create the command in. */
+    Object *oPtr,		/* The object to make the command for. */
+    const char *nameStr)	/* The name of the command. */
+{
+    Tcl_DString buffer;
+
+    if (nameStr[0] != ':' || nameStr[1] != ':') {
+	Tcl_DStringInit(&buffer);
+	Tcl_DStringAppend(&buffer,
+		Tcl_GetCurrentNamespace(interp)->fullName, -1);
+	Tcl_DStringAppend(&buffer, "::", 2);
+	Tcl_DStringAppend(&buffer, nameStr, -1);
+	oPtr->command = Tcl_CreateObjCommand(interp,
+		Tcl_DStringValue(&buffer), PublicObjectCmd, oPtr, NULL);
+	Tcl_DStringFree(&buffer);
+    } else {
+	oPtr->command = Tcl_CreateObjCommand(interp, nameStr,
+		PublicObjectCmd, oPtr, NULL);
+    }
+
+    /*
+     * We use a trace because we need to know about renames as well as
+     * deletes.
+     */
+
+    Tcl_TraceCommand(interp, TclGetString(TclOOObjectName(interp, oPtr)),
+	    TCL_TRACE_RENAME|TCL_TRACE_DELETE, ObjectRenamedTrace, oPtr);
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -696,6 +797,55 @@ SquelchCachedName(
 	oPtr->cachedNameObj = NULL;
     }
 }
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * UnindexInstanceNames, IndexInstanceNames --
+ *
+ *	Take the object out of, and put it back into, the name indices of the
+ *	classes that it is an instance of (directly or by mixin). Called when
+ *	the object's command is renamed or deleted; the object is looked for
+ *	under the name it had before that. A mixin that is also the object's
+ *	class does not list the object as an instance a second time.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static inline void
+UnindexInstanceNames(
+    Object *oPtr,
+    const char *oldName)
+{
+    Class *mixinPtr;
+    int i;
+
+    if (oPtr->selfCls != NULL) {
+	TclOOUnindexInstance(oPtr->selfCls, oPtr, oldName);
+    }
+    FOREACH(mixinPtr, oPtr->mixins) {
+	if (mixinPtr != NULL && mixinPtr != oPtr->selfCls) {
+	    TclOOUnindexInstance(mixinPtr, oPtr, oldName);
+	}
+    }
+}
+
+static inline void
+IndexInstanceNames(
+    Object *oPtr)
+{
+    Class *mixinPtr;
+    int i;
+
+    if (oPtr->selfCls != NULL) {
+	TclOOIndexInstance(oPtr->selfCls, oPtr);
+    }
+    FOREACH(mixinPtr, oPtr->mixins) {
+	if (mixinPtr != NULL && mixinPtr != oPtr->selfCls) {
+	    TclOOIndexInstance(mixinPtr, oPtr);
+	}
+    }
+}
 
 /*
  * ----------------------------------------------------------------------
@@ -744,13 +894,26 @@ ObjectRenamedTrace(
     Object *oPtr = clientData;
     Foundation *fPtr = oPtr->fPtr;
 
+    /*
+     * Either way, the object is no longer where its classes' name indices
+     * say it is. (It has to come out of all of them before going back in,
+     * as it is in a class's index twice if it has that class as a mixin
+     * twice.)
+     */
+
+    UnindexInstanceNames(oPtr, oldName);
+
     /*
      * If this is a rename and not a delete of the object, we just flush the
      * cache of the object name.
      */
 
     if (flags & TCL_TRACE_RENAME) {
+	IndexInstanceNames(oPtr);
 	SquelchCachedName(oPtr);
+	if (oPtr->classPtr != NULL) {
+	    fPtr->classNameEpoch++;
+	}
 	return;
     }
 
@@ -820,10 +983,11 @@ ObjectRenamedTrace(
 
     /*
      * The namespace is only deleted if it hasn't already been deleted. [Bug
-     * 2950259]
+     * 2950259] Nor is it deleted if the object's shell goes into its class's
+     * pool for reuse.
      */
 
-    if (oPtr->namespacePtr != NULL) {
+    if (oPtr->namespacePtr != NULL && !PoolObject(interp, oPtr)) {
 	Tcl_Namespace *namespacePtr = oPtr->namespacePtr;
 
 	oPtr->namespacePtr = NULL;
@@ -867,6 +1031,7 @@ ClearMixins(
     ckfree((char *) clsPtr->mixins.list);
     clsPtr->mixins.list = NULL;
     clsPtr->mixins.num = 0;
+    clsPtr->thisPtr->fPtr->ancestryEpoch++;
 }
 
 static void
@@ -886,6 +1051,7 @@ ClearSuperclasses(
     ckfree((char *) clsPtr->superclasses.list);
     clsPtr->superclasses.list = NULL;
     clsPtr->superclasses.num = 0;
+    clsPtr->thisPtr->fPtr->ancestryEpoch++;
 }
 
 /*
@@ -954,6 +1120,7 @@ ReleaseClassContents(
 		Class *mixin = instancePtr->mixins.list[j];
 		if (mixin == clsPtr) {
 		    instancePtr->mixins.list[j] = NULL;
+		    TclOOObjectChanged(instancePtr);
 		}
 	    }
 	    if (instancePtr != NULL && !IsRoot(instancePtr)) {
@@ -1003,9 +1170,11 @@ ReleaseClassContents(
     }
 
     /*
-     * Squelch instances of this class (includes objects we're mixed into).
+     * Squelch instances of this class (includes objects we're mixed into),
+     * including the shells of the ones that have been pooled.
      */
 
+    DrainPool(clsPtr, 0);
     if (!IsRootClass(oPtr)) {
 	FOREACH(instancePtr, clsPtr->instances) {
 	    if (instancePtr == NULL || IsRoot(instancePtr)) {
@@ -1030,6 +1199,7 @@ ReleaseClassContents(
 	clsPtr->instances.list = NULL;
 	clsPtr->instances.num = 0;
     }
+    TclOOForgetInstanceIndex(clsPtr);
 
     /*
      * Special: We delete these after everything else.
@@ -1046,21 +1216,40 @@ ReleaseClassContents(
     if (clsPtr->constructorChainPtr) {
 	TclOODeleteChain(clsPtr->constructorChainPtr);
 	clsPtr->constructorChainPtr = NULL;
+	fPtr->stats.chainsFreed++;
     }
     if (clsPtr->destructorChainPtr) {
 	TclOODeleteChain(clsPtr->destructorChainPtr);
 	clsPtr->destructorChainPtr = NULL;
+	fPtr->stats.chainsFreed++;
+    }
+    for (i=0 ; i<2 ; i++) {
+	TclOODeleteChain(clsPtr->filterChainPtr[i]);
+	clsPtr->filterChainPtr[i] = NULL;
     }
     if (clsPtr->classChainCache) {
 	CallChain *callPtr;
 
 	FOREACH_HASH_VALUE(callPtr, clsPtr->classChainCache) {
-	    TclOODeleteChain(callPtr);
+	    if (callPtr) {
+		TclOODeleteChain(callPtr);
+		fPtr->stats.chainsFreed++;
+	    }
 	}
 	Tcl_DeleteHashTable(clsPtr->classChainCache);
 	ckfree((char *) clsPtr->classChainCache);
 	clsPtr->classChainCache = NULL;
     }
+    if (clsPtr->unfilteredChainCache) {
+	fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(clsPtr->unfilteredChainCache);
+	clsPtr->unfilteredChainCache = NULL;
+    }
+    if (clsPtr->ancestors) {
+	ckfree((char *) clsPtr->ancestors);
+	clsPtr->ancestors = NULL;
+	clsPtr->numAncestors = 0;
+    }
 
     /*
      * Squelch our filter list.
@@ -1093,6 +1282,34 @@ ReleaseClassContents(
     }
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ForgetWeakRef --
+ *
+ *	Take an object out of the foundation's table of weakly referenced
+ *	objects, so that weak references made to it will never find it again.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+ForgetWeakRef(
+    Object *oPtr)
+{
+    Tcl_HashEntry *hPtr;
+
+    if (!(oPtr->flags & WEAKLY_REFERENCED)) {
+	return;
+    }
+    hPtr = Tcl_FindHashEntry(&oPtr->fPtr->weakRefTable,
+	    (char *) INT2PTR(oPtr->creationEpoch));
+    if (hPtr != NULL) {
+	Tcl_DeleteHashEntry(hPtr);
+    }
+    oPtr->flags &= ~WEAKLY_REFERENCED;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1113,11 +1330,39 @@ ObjectNamespaceDeleted(
 {
     Object *oPtr = clientData;
     FOREACH_HASH_DECLS;
-    Class *clsPtr = oPtr->classPtr, *mixinPtr;
+    Class *clsPtr = oPtr->classPtr, *mixinPtr, *poolClsPtr = NULL;
     Method *mPtr;
     Tcl_Obj *filterObj, *variableObj;
     int i;
 
+    /*
+     * A pooled shell has already been taken out of its class and counted as
+     * gone; it just has to be taken out of the pool too. The reference to
+     * the class that the pool held is released at the end.
+     */
+
+    if (oPtr->flags & OBJECT_POOLED) {
+	Object *pooledPtr;
+
+	poolClsPtr = oPtr->selfCls;
+	FOREACH(pooledPtr, poolClsPtr->pool) {
+	    if (pooledPtr == oPtr) {
+		poolClsPtr->pool.list[i] =
+			poolClsPtr->pool.list[--poolClsPtr->pool.num];
+		break;
+	    }
+	}
+	oPtr->flags &= ~OBJECT_POOLED;
+	oPtr->fPtr->numObjects++;
+    }
+
+    /*
+     * Mark the object as going, so that it is not put into a pool by the
+     * deletion of its command below.
+     */
+
+    oPtr->flags |= OBJECT_DELETED;
+
     /*
      * Instruct everyone to no longer use any allocated fields of the object.
      * Also delete the commands that refer to the object at this point (if
@@ -1132,6 +1377,13 @@ ObjectNamespaceDeleted(
 	Tcl_DeleteCommandFromToken(oPtr->fPtr->interp, oPtr->myCommand);
     }
 
+    /*
+     * Weak references to the object must not find it from now on; this is
+     * what stops them from ever seeing its memory after it is freed.
+     */
+
+    ForgetWeakRef(oPtr);
+
     /*
      * Splice the object out of its context. After this, we must *not* call
      * methods on the object.
@@ -1172,11 +1424,21 @@ ObjectNamespaceDeleted(
 	ckfree((char *) oPtr->variables.list);
     }
 
+    oPtr->fPtr->numObjects--;
     if (oPtr->chainCache) {
-	TclOODeleteChainCache(oPtr->chainCache);
+	oPtr->fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(oPtr->chainCache);
     }
+    if (oPtr->unfilteredChainCache) {
+	oPtr->fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(oPtr->unfilteredChainCache);
+    }
+    TclOOReleaseShape(oPtr);
+    TclOODeleteChain(oPtr->filterChainPtr[0]);
+    TclOODeleteChain(oPtr->filterChainPtr[1]);
 
     SquelchCachedName(oPtr);
+    ReleaseMappedNames(oPtr);
 
     if (oPtr->metadataPtr != NULL) {
 	Tcl_ObjectMetadataType *metadataTypePtr;
@@ -1198,6 +1460,7 @@ ObjectNamespaceDeleted(
 	Tcl_ObjectMetadataType *metadataTypePtr;
 	ClientData value;
 
+	oPtr->fPtr->numClasses--;
 	if (clsPtr->metadataPtr != NULL) {
 	    FOREACH_HASH(metadataTypePtr, value, clsPtr->metadataPtr) {
 		metadataTypePtr->deleteProc(value);
@@ -1226,10 +1489,16 @@ ObjectNamespaceDeleted(
 	    ckfree((char *) clsPtr->instances.list);
 	    clsPtr->instances.num = 0;
 	}
+	TclOOForgetInstanceIndex(clsPtr);
 	if (clsPtr->mixinSubs.list) {
 	    ckfree((char *) clsPtr->mixinSubs.list);
 	    clsPtr->mixinSubs.num = 0;
 	}
+	if (clsPtr->pool.list) {
+	    ckfree((char *) clsPtr->pool.list);
+	    clsPtr->pool.list = NULL;
+	    clsPtr->pool.num = 0;
+	}
 
 	FOREACH_HASH_VALUE(mPtr, &clsPtr->classMethods) {
 	    TclOODelMethodRef(mPtr);
@@ -1247,6 +1516,9 @@ ObjectNamespaceDeleted(
 
 	DelRef(clsPtr);
     }
+    if (poolClsPtr != NULL) {
+	DelRef(poolClsPtr);
+    }
 
     /*
      * Delete the object structure itself.
@@ -1255,6 +1527,299 @@ ObjectNamespaceDeleted(
     DelRef(oPtr);
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * PoolObject --
+ *
+ *	Called once an object's public command has gone and its destructor
+ *	has been run, to try to keep the shell of the object (its structure,
+ *	namespace and [my] command) in its class's pool instead of deleting
+ *	it. That is only done if the class has room in its pool and the object
+ *	is a plain instance of the class that can be put back exactly as it
+ *	was when it was first made; all its variables are unset to do so.
+ *	Returns 1 if the shell was pooled, and 0 if the object must be deleted
+ *	as normal.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+PoolObject(
+    Tcl_Interp *interp,		/* The interpreter containing the object. */
+    Object *oPtr)		/* The object being deleted. */
+{
+    Class *clsPtr = oPtr->selfCls;
+    Foundation *fPtr = oPtr->fPtr;
+
+    if (clsPtr->pool.num >= clsPtr->poolSize || Tcl_InterpDeleted(interp)
+	    || oPtr->classPtr != NULL || IsRoot(oPtr)
+	    || (oPtr->flags & (OBJECT_DELETED|CLASS_GONE|OBJECT_POOLED))
+	    || !(oPtr->flags & USE_CLASS_CACHE) || Deleted(clsPtr->thisPtr)
+	    || oPtr->methodsPtr != NULL || oPtr->metadataPtr != NULL
+	    || oPtr->mapMethodNameProc != NULL
+	    || oPtr->mapMethodNameProc2 != NULL || oPtr->variables.num
+	    || oPtr->myCommand == NULL) {
+	return 0;
+    }
+    if (!ResetObjectVariables(interp, oPtr) || !ShellIsClean(oPtr)) {
+	return 0;
+    }
+
+    /*
+     * Take the object out of its class and make everything that refers to
+     * it by name or identity think it is gone. The pool keeps a reference to
+     * the class, so that the shell can always find its way out of the pool.
+     */
+
+    oPtr->flags |= OBJECT_POOLED;
+    AddRef(clsPtr);
+    SquelchCachedName(oPtr);
+    ForgetWeakRef(oPtr);
+    TclOORemoveFromInstances(oPtr, clsPtr);
+    if (oPtr->chainCache) {
+	fPtr->stats.chainsFreed += TclOODeleteChainCache(oPtr->chainCache);
+	oPtr->chainCache = NULL;
+    }
+    if (oPtr->unfilteredChainCache) {
+	fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(oPtr->unfilteredChainCache);
+	oPtr->unfilteredChainCache = NULL;
+    }
+    TclOODeleteChain(oPtr->filterChainPtr[0]);
+    TclOODeleteChain(oPtr->filterChainPtr[1]);
+    oPtr->filterChainPtr[0] = oPtr->filterChainPtr[1] = NULL;
+    ReleaseMappedNames(oPtr);
+    TclOOReleaseShape(oPtr);
+    fPtr->numObjects--;
+
+    if (clsPtr->pool.list == NULL) {
+	clsPtr->pool.list = (Object **)
+		ckalloc(sizeof(Object *) * clsPtr->poolSize);
+    }
+    clsPtr->pool.list[clsPtr->pool.num++] = oPtr;
+    return 1;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ResetObjectVariables --
+ *
+ *	Unset all the variables in an object's namespace. Returns 1 if that
+ *	left the namespace with no variables at all, and 0 if something (such
+ *	as a trace or a link from elsewhere) has kept one of them alive.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+ResetObjectVariables(
+    Tcl_Interp *interp,		/* The interpreter containing the object. */
+    Object *oPtr)		/* The object whose variables are to go. */
+{
+    FOREACH_HASH_DECLS;
+    Namespace *nsPtr = (Namespace *) oPtr->namespacePtr;
+    TclVarHashTable *tablePtr = &nsPtr->varTable;
+    VarInHash *vihPtr;
+    Tcl_Obj *namesObj, **nameObjs;
+    Tcl_InterpState state;
+    Tcl_DString buffer;
+    int numNames, i;
+
+    if (tablePtr->table.numEntries == 0) {
+	return 1;
+    }
+
+    /*
+     * Collect the names first; unsetting a variable changes the table that
+     * we would otherwise be iterating over. Note that this involves horrific
+     * knowledge of the guts of tclVar.c, as in [info object vars].
+     */
+
+    namesObj = Tcl_NewObj();
+    Tcl_IncrRefCount(namesObj);
+    FOREACH_HASH_VALUE(vihPtr, &tablePtr->table) {
+	Tcl_ListObjAppendElement(NULL, namesObj, vihPtr->entry.key.objPtr);
+    }
+    Tcl_ListObjGetElements(NULL, namesObj, &numNames, &nameObjs);
+
+    /*
+     * Unset traces may run scripts; don't let them disturb the result of
+     * whatever is deleting the object.
+     */
+
+    state = Tcl_SaveInterpState(interp, TCL_OK);
+    Tcl_DStringInit(&buffer);
+    for (i=0 ; i<numNames ; i++) {
+	Tcl_DStringSetLength(&buffer, 0);
+	Tcl_DStringAppend(&buffer, nsPtr->fullName, -1);
+	Tcl_DStringAppend(&buffer, "::", 2);
+	Tcl_DStringAppend(&buffer, TclGetString(nameObjs[i]), -1);
+	Tcl_UnsetVar2(interp, Tcl_DStringValue(&buffer), NULL,
+		TCL_GLOBAL_ONLY);
+    }
+    Tcl_DStringFree(&buffer);
+    Tcl_RestoreInterpState(interp, state);
+    Tcl_DecrRefCount(namesObj);
+
+    return (tablePtr->table.numEntries == 0);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ShellIsClean --
+ *
+ *	Check that an object's namespace holds nothing but its [my] command,
+ *	under that name, so that it is indistinguishable from a freshly made
+ *	one. The namespace of a pooled shell is still visible to scripts, so
+ *	this is checked both when the shell goes into the pool and when it
+ *	comes out.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+ShellIsClean(
+    Object *oPtr)
+{
+    Namespace *nsPtr = (Namespace *) oPtr->namespacePtr;
+    Command *myPtr = (Command *) oPtr->myCommand;
+
+    return (nsPtr != NULL && myPtr != NULL && myPtr->nsPtr == nsPtr
+	    && myPtr->hPtr != NULL
+	    && !strcmp(Tcl_GetHashKey(&nsPtr->cmdTable, myPtr->hPtr), "my")
+	    && !(nsPtr->flags & (NS_DYING|NS_DEAD))
+	    && nsPtr->activationCount == 0
+	    && nsPtr->cmdTable.numEntries == 1
+	    && nsPtr->childTable.numEntries == 0
+	    && nsPtr->varTable.table.numEntries == 0
+	    && nsPtr->numExportPatterns == 0
+	    && nsPtr->ensembles == NULL
+	    && nsPtr->unknownHandlerPtr == NULL);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TakeFromPool --
+ *
+ *	Get a shell out of a class's pool and make it into a new instance of
+ *	the class, ready for its constructors to be run. The object gets a new
+ *	identity (creation epoch) and a new public command; nothing that
+ *	referred to the object that was destroyed will find it. Shells that
+ *	have been tampered with while in the pool are deleted. Returns NULL if
+ *	there are no usable shells.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static Object *
+TakeFromPool(
+    Tcl_Interp *interp,		/* Interpreter within which to create the
+				 * object. */
+    Class *clsPtr,		/* The class to take a shell from. */
+    const char *nameStr)	/* The name of the object to create, or NULL
+				 * if the OO system should pick the object
+				 * name itself. */
+{
+    Foundation *fPtr = clsPtr->thisPtr->fPtr;
+    char objName[10 + TCL_INTEGER_SPACE];
+    Object *oPtr;
+
+    while (1) {
+	if (clsPtr->pool.num == 0) {
+	    return NULL;
+	}
+	oPtr = clsPtr->pool.list[--clsPtr->pool.num];
+	if (ShellIsClean(oPtr)) {
+	    break;
+	}
+	Tcl_DeleteNamespace(oPtr->namespacePtr);
+    }
+    oPtr->flags = USE_CLASS_CACHE;
+    DelRef(clsPtr);
+
+    /*
+     * Give the object a new identity. Names are generated the same way as
+     * for new namespaces, so that the new name is as unique as a new
+     * object's would be.
+     */
+
+    if (nameStr == NULL) {
+	do {
+	    sprintf(objName, "::oo::Obj%d", ++fPtr->tsdPtr->nsCount);
+	} while (Tcl_FindCommand(interp, objName, NULL, TCL_GLOBAL_ONLY));
+	nameStr = objName;
+    } else {
+	++fPtr->tsdPtr->nsCount;
+    }
+    oPtr->creationEpoch = fPtr->tsdPtr->nsCount;
+    fPtr->numObjects++;
+    TclOOObjectChanged(oPtr);
+
+    /*
+     * Put the namespace back the way that AllocObject made it, if its path
+     * was changed, and make the public command.
+     */
+
+    if (fPtr->helpersNs != NULL) {
+	Namespace *nsPtr = (Namespace *) oPtr->namespacePtr;
+
+	if (nsPtr->commandPathLength != 1 || nsPtr->commandPathArray[0].nsPtr
+		!= (Namespace *) fPtr->helpersNs) {
+	    TclSetNsPath(nsPtr, 1, &fPtr->helpersNs);
+	}
+    }
+    MakeObjectCommand(interp, oPtr, nameStr);
+    return oPtr;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DrainPool, TclOOSetPoolSize --
+ *
+ *	Manage the size of a class's pool of object shells. DrainPool deletes
+ *	shells until there are at most keep of them left; TclOOSetPoolSize
+ *	changes how many the class may keep, which is what [oo::define pool]
+ *	does.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+DrainPool(
+    Class *clsPtr,
+    int keep)
+{
+    while (clsPtr->pool.num > keep) {
+	Object *oPtr = clsPtr->pool.list[--clsPtr->pool.num];
+
+	Tcl_DeleteNamespace(oPtr->namespacePtr);
+    }
+}
+
+void
+TclOOSetPoolSize(
+    Class *clsPtr,
+    int size)
+{
+    DrainPool(clsPtr, size);
+    if (clsPtr->pool.list != NULL) {
+	if (size == 0) {
+	    ckfree((char *) clsPtr->pool.list);
+	    clsPtr->pool.list = NULL;
+	} else {
+	    clsPtr->pool.list = (Object **)
+		    ckrealloc((char *) clsPtr->pool.list,
+		    sizeof(Object *) * size);
+	}
+    }
+    clsPtr->poolSize = size;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1283,6 +1848,7 @@ TclOORemoveFromInstances(
     return;
 
   removeInstance:
+    TclOOUnindexInstance(clsPtr, oPtr, NULL);
     if (Deleted(clsPtr->thisPtr)) {
 	DelRef(clsPtr->instances.list[i]);
 	clsPtr->instances.list[i] = NULL;
@@ -1327,8 +1893,14 @@ TclOOAddToInstances(
 		    ckrealloc((char *) clsPtr->instances.list,
 		    sizeof(Object *) * clsPtr->instances.size);
 	}
+	if (clsPtr->instanceIndex != NULL) {
+	    clsPtr->instanceIndex = (Object **)
+		    ckrealloc((char *) clsPtr->instanceIndex,
+		    sizeof(Object *) * clsPtr->instances.size);
+	}
     }
     clsPtr->instances.list[clsPtr->instances.num++] = oPtr;
+    TclOOIndexInstance(clsPtr, oPtr);
 }
 
 /*
@@ -1506,6 +2078,7 @@ AllocClass(
      */
 
     memset(clsPtr, 0, sizeof(Class));
+    fPtr->numClasses++;
     if (useThisObj == NULL) {
 	clsPtr->thisPtr = AllocObject(fPtr, interp, NULL, NULL);
     } else {
@@ -1605,7 +2178,13 @@ Tcl_NewObjectInstance(
      * Create the object.
      */
 
-    oPtr = AllocObject(fPtr, interp, nameStr, nsNameStr);
+    oPtr = NULL;
+    if (classPtr->pool.num > 0 && nsNameStr == NULL) {
+	oPtr = TakeFromPool(interp, classPtr, nameStr);
+    }
+    if (oPtr == NULL) {
+	oPtr = AllocObject(fPtr, interp, nameStr, nsNameStr);
+    }
     oPtr->selfCls = classPtr;
     TclOOAddToInstances(oPtr, classPtr);
 
@@ -1627,6 +2206,13 @@ Tcl_NewObjectInstance(
 	TclOOAddToSubclasses(oPtr->classPtr, fPtr->objectCls);
     }
 
+    /*
+     * That is the last change made to the object's namespace in setting it
+     * up.
+     */
+
+    SettleNamespace(oPtr);
+
     /*
      * Run constructors, except when objc < 0 (a special flag case used for
      * object cloning only).
@@ -1796,8 +2382,8 @@ Tcl_CopyObjectInstance(
      * call.
      */
 
-    o2Ptr->flags = oPtr->flags & ~(
-	    OBJECT_DELETED | ROOT_OBJECT | ROOT_CLASS | FILTER_HANDLING);
+    o2Ptr->flags = oPtr->flags & ~(OBJECT_DELETED | WEAKLY_REFERENCED
+	    | OBJECT_POOLED | ROOT_OBJECT | ROOT_CLASS | FILTER_HANDLING);
 
     /*
      * Copy the object's metadata.
@@ -1881,6 +2467,13 @@ Tcl_CopyObjectInstance(
 	    Tcl_IncrRefCount(variableObj);
 	}
 
+	/*
+	 * The duplicate pools its instances like the source class does, but
+	 * starts with an empty pool.
+	 */
+
+	cls2Ptr->poolSize = clsPtr->poolSize;
+
 	/*
 	 * Duplicate the source class's mixins (which cannot be circular
 	 * references to the duplicate).
@@ -1896,6 +2489,7 @@ Tcl_CopyObjectInstance(
 	FOREACH(mixinPtr, cls2Ptr->mixins) {
 	    TclOOAddToMixinSubs(cls2Ptr, mixinPtr);
 	}
+	cls2Ptr->thisPtr->fPtr->ancestryEpoch++;
 
 	/*
 	 * Duplicate the source class's methods, constructor and destructor.
@@ -2267,6 +2861,16 @@ PrivateObjectCmd(
     int objc,
     Tcl_Obj *const *objv)
 {
+    /*
+     * The [my] command of a pooled shell is still there to be found, but
+     * there is no object for it to call methods on.
+     */
+
+    if (((Object *) clientData)->flags & OBJECT_POOLED) {
+	Tcl_AppendResult(interp, "object has been deleted", NULL);
+	Tcl_SetErrorCode(interp, "TCLOO", "DELETED_OBJECT", NULL);
+	return TCL_ERROR;
+    }
     return TclOOObjectCmdCore(clientData, interp, objc, objv, 0, NULL);
 }
 
@@ -2333,7 +2937,16 @@ TclOOObjectCmdCore(
      */
 
     methodNamePtr = objv[1];
-    if (oPtr->mapMethodNameProc != NULL) {
+    if (oPtr->mapMethodNameProc2 != NULL) {
+	result = MapMethodName(interp, oPtr, objv[1], &methodNamePtr,
+		&startCls);
+	if (result != TCL_OK) {
+	    if (result == TCL_ERROR) {
+		Tcl_AddErrorInfo(interp, "\n    (while mapping method name)");
+	    }
+	    return result;
+	}
+    } else if (oPtr->mapMethodNameProc != NULL) {
 	register Class **startClsPtr = &startCls;
 
 	methodNamePtr = Tcl_DuplicateObj(methodNamePtr);
@@ -2505,35 +3118,66 @@ Tcl_GetObjectFromObj(
 				 * the name does not refer to an object. */
     Tcl_Obj *objPtr)		/* The name of the object to look up, which is
 				 * exactly the name of its public command. */
+{
+    Object *oPtr = TclOOLookupObject(interp, objPtr);
+
+    if (oPtr == NULL) {
+	Tcl_AppendResult(interp, Tcl_GetString(objPtr),
+		" does not refer to an object", NULL);
+	Tcl_SetErrorCode(interp, "TCLOO", "LOOKUP", "OBJECT",
+		Tcl_GetString(objPtr), NULL);
+    }
+    return (Tcl_Object) oPtr;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOLookupObject --
+ *
+ *	Like Tcl_GetObjectFromObj, but returns NULL without touching the
+ *	interpreter result if the name does not refer to an object. For
+ *	callers (such as [oo::isa]) for which that is not an error.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Object *
+TclOOLookupObject(
+    Tcl_Interp *interp,		/* Interpreter in which to locate the
+				 * object. */
+    Tcl_Obj *objPtr)		/* The name of the object to look up. */
 {
     Command *cmdPtr = (Command *) Tcl_GetCommandFromObj(interp, objPtr);
 
+    /*
+     * Tcl_GetCommandFromObj keeps the resolved command in the name's
+     * internal representation, so a repeated lookup with the same Tcl_Obj
+     * only has to check that the command is still an object.
+     */
+
     if (cmdPtr == NULL) {
-	goto notAnObject;
+	return NULL;
     }
     if (cmdPtr->objProc != PublicObjectCmd) {
 	cmdPtr = (Command *) TclGetOriginalCommand((Tcl_Command) cmdPtr);
 	if (cmdPtr == NULL || cmdPtr->objProc != PublicObjectCmd) {
-	    goto notAnObject;
+	    return NULL;
 	}
     }
     return cmdPtr->objClientData;
-
-  notAnObject:
-    Tcl_AppendResult(interp, Tcl_GetString(objPtr),
-	    " does not refer to an object", NULL);
-    Tcl_SetErrorCode(interp, "TCLOO", "LOOKUP", "OBJECT",
-	    Tcl_GetString(objPtr), NULL);
-    return NULL;
 }
 
 /*
  * ----------------------------------------------------------------------
  *
- * TclOOIsReachable --
+ * TclOOIsReachable, Tcl_ClassIsSubclass --
  *
- *	Utility function that tests whether a class is a subclass (whether
- *	directly or indirectly) of another class.
+ *	Utility functions that test whether a class is a subclass (whether
+ *	directly or indirectly, and including through mixins) of another
+ *	class. The set of classes reachable from a class is worked out once
+ *	and remembered until the superclasses or mixins of some class next
+ *	change, so the test is a binary search.
  *
  * ----------------------------------------------------------------------
  */
@@ -2543,30 +3187,252 @@ TclOOIsReachable(
     Class *targetPtr,
     Class *startPtr)
 {
-    int i;
-    Class *superPtr;
+    int id, lo, hi;
 
-  tailRecurse:
     if (startPtr == targetPtr) {
 	return 1;
     }
-    if (startPtr->superclasses.num == 1 && startPtr->mixins.num == 0) {
-	startPtr = startPtr->superclasses.list[0];
-	goto tailRecurse;
+    if (startPtr->ancestors == NULL || startPtr->ancestryEpoch
+	    != startPtr->thisPtr->fPtr->ancestryEpoch) {
+	ComputeAncestors(startPtr);
     }
-    FOREACH(superPtr, startPtr->superclasses) {
-	if (TclOOIsReachable(targetPtr, superPtr)) {
+
+    id = targetPtr->thisPtr->creationEpoch;
+    lo = 0;
+    hi = startPtr->numAncestors - 1;
+    while (lo <= hi) {
+	int mid = (lo + hi) / 2;
+
+	if (startPtr->ancestors[mid] == id) {
 	    return 1;
+	} else if (startPtr->ancestors[mid] < id) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid - 1;
 	}
     }
-    FOREACH(superPtr, startPtr->mixins) {
-	if (TclOOIsReachable(targetPtr, superPtr)) {
-	    return 1;
+    return 0;
+}
+
+int
+Tcl_ClassIsSubclass(
+    Tcl_Class clazz,
+    Tcl_Class superclass)
+{
+    return TclOOIsReachable((Class *) superclass, (Class *) clazz);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ComputeAncestors --
+ *
+ *	Works out the (sorted) creation epochs of all the classes reachable
+ *	from a class through superclasses and mixins, for TclOOIsReachable.
+ *	Creation epochs are used rather than addresses so that a deleted class
+ *	can never be mistaken for a new one.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+ComputeAncestors(
+    Class *clsPtr)
+{
+    Tcl_HashTable doneTable;
+    Class **stack, *cPtr, *superPtr;
+    int i, isNew, depth = 0, stackSize = 16, num = 0, size = 8;
+    int *ids = (int *) ckalloc(sizeof(int) * size);
+
+    Tcl_InitHashTable(&doneTable, TCL_ONE_WORD_KEYS);
+    stack = (Class **) ckalloc(sizeof(Class *) * stackSize);
+    stack[depth++] = clsPtr;
+    while (depth > 0) {
+	cPtr = stack[--depth];
+	Tcl_CreateHashEntry(&doneTable, (char *) cPtr, &isNew);
+	if (!isNew) {
+	    continue;
+	}
+
+	if (num == size) {
+	    size *= 2;
+	    ids = (int *) ckrealloc((char *) ids, sizeof(int) * size);
+	}
+	ids[num++] = cPtr->thisPtr->creationEpoch;
+
+	if (depth + cPtr->superclasses.num + cPtr->mixins.num > stackSize) {
+	    stackSize = 2 * (depth + cPtr->superclasses.num
+		    + cPtr->mixins.num);
+	    stack = (Class **) ckrealloc((char *) stack,
+		    sizeof(Class *) * stackSize);
+	}
+	FOREACH(superPtr, cPtr->superclasses) {
+	    stack[depth++] = superPtr;
+	}
+	FOREACH(superPtr, cPtr->mixins) {
+	    if (superPtr != NULL) {
+		stack[depth++] = superPtr;
+	    }
 	}
     }
-    return 0;
+    ckfree((char *) stack);
+    Tcl_DeleteHashTable(&doneTable);
+
+    qsort(ids, (unsigned) num, sizeof(int), CmpInt);
+    if (clsPtr->ancestors != NULL) {
+	ckfree((char *) clsPtr->ancestors);
+    }
+    clsPtr->ancestors = ids;
+    clsPtr->numAncestors = num;
+    clsPtr->ancestryEpoch = clsPtr->thisPtr->fPtr->ancestryEpoch;
 }
-
+
+static int
+CmpInt(
+    const void *ptr1,
+    const void *ptr2)
+{
+    int i1 = *(const int *) ptr1;
+    int i2 = *(const int *) ptr2;
+
+    return (i1 < i2) ? -1 : (i1 > i2);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Tcl_ClassForeachInstance --
+ *
+ *	Calls a function for each (live) instance of a class, and with the
+ *	TCL_OO_INSTANCES_ALL flag, for each instance of the classes below it
+ *	too. Nothing is allocated, so this is suitable for counting. The
+ *	function is stopped by the callback returning anything other than
+ *	TCL_OK; TCL_BREAK stops it quietly. The callback must not create,
+ *	delete or reclassify instances of the classes being visited.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+Tcl_ClassForeachInstance(
+    Tcl_Class clazz,		/* The class whose instances to visit. */
+    int flags,			/* TCL_OO_INSTANCES_ALL to also visit the
+				 * instances of subclasses. */
+    Tcl_ClassInstanceProc *proc,
+				/* What to call for each instance. */
+    ClientData clientData)	/* Passed to proc. */
+{
+    Class *clsPtr = (Class *) clazz;
+    Object *oPtr;
+    int i, result = TCL_OK;
+
+    if (flags & TCL_OO_INSTANCES_ALL) {
+	result = ForeachInstanceBelow(clsPtr, clsPtr, proc, clientData);
+    } else {
+	FOREACH(oPtr, clsPtr->instances) {
+	    if (oPtr == NULL || oPtr->command == NULL) {
+		continue;
+	    }
+	    result = proc(clientData, (Tcl_Object) oPtr);
+	    if (result != TCL_OK) {
+		break;
+	    }
+	}
+    }
+    return (result == TCL_BREAK ? TCL_OK : result);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ForeachInstanceBelow --
+ *
+ *	Worker for Tcl_ClassForeachInstance that visits the instances of a
+ *	class in the tree below a root class, and then recurses into the
+ *	classes below that one. The same class (or object) can be reached by
+ *	more than one route, through multiple inheritance and mixins; it is
+ *	only visited by way of the first of its superclasses, mixins or
+ *	classes (in declaration order) that is itself below the root, which
+ *	TclOOIsReachable tells us without our keeping a record of where we
+ *	have been.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+ForeachInstanceBelow(
+    Class *rootPtr,		/* The class that the walk started at. */
+    Class *clsPtr,		/* The class to visit now. */
+    Tcl_ClassInstanceProc *proc,
+    ClientData clientData)
+{
+    Object *oPtr;
+    Class *subPtr, *viaPtr;
+    int i, j, result;
+
+    FOREACH(oPtr, clsPtr->instances) {
+	if (oPtr == NULL || oPtr->command == NULL) {
+	    continue;
+	}
+	if (oPtr->selfCls != clsPtr) {
+	    /*
+	     * Instance by mixin. Visited with its class if that is below the
+	     * root, and otherwise only here if this is the first of its
+	     * mixins that is below the root.
+	     */
+
+	    if (TclOOIsReachable(rootPtr, oPtr->selfCls)) {
+		continue;
+	    }
+	    for (j=0 ; j<oPtr->mixins.num ; j++) {
+		viaPtr = oPtr->mixins.list[j];
+		if (viaPtr != NULL && TclOOIsReachable(rootPtr, viaPtr)) {
+		    break;
+		}
+	    }
+	    if (j == oPtr->mixins.num || oPtr->mixins.list[j] != clsPtr) {
+		continue;
+	    }
+	}
+	result = proc(clientData, (Tcl_Object) oPtr);
+	if (result != TCL_OK) {
+	    return result;
+	}
+    }
+
+    for (j=0 ; j<clsPtr->subclasses.num+clsPtr->mixinSubs.num ; j++) {
+	if (j < clsPtr->subclasses.num) {
+	    subPtr = clsPtr->subclasses.list[j];
+	} else {
+	    subPtr = clsPtr->mixinSubs.list[j - clsPtr->subclasses.num];
+	}
+	if (subPtr == NULL || subPtr == rootPtr) {
+	    continue;
+	}
+
+	FOREACH(viaPtr, subPtr->superclasses) {
+	    if (TclOOIsReachable(rootPtr, viaPtr)) {
+		goto gotVia;
+	    }
+	}
+	FOREACH(viaPtr, subPtr->mixins) {
+	    if (viaPtr != NULL && TclOOIsReachable(rootPtr, viaPtr)) {
+		goto gotVia;
+	    }
+	}
+	continue;
+
+    gotVia:
+	if (viaPtr == clsPtr) {
+	    result = ForeachInstanceBelow(rootPtr, subPtr, proc, clientData);
+	    if (result != TCL_OK) {
+		return result;
+	    }
+	}
+    }
+    return TCL_OK;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -2690,9 +3556,219 @@ Tcl_ObjectSetMethodNameMapper(
     Tcl_Object object,
     Tcl_ObjectMapMethodNameProc *mapMethodNameProc)
 {
-    ((Object *) object)->mapMethodNameProc = mapMethodNameProc;
+    Object *oPtr = (Object *) object;
+
+    oPtr->mapMethodNameProc = mapMethodNameProc;
+    oPtr->mapMethodNameProc2 = NULL;
+    ReleaseMappedNames(oPtr);
+}
+
+Tcl_ObjectMapMethodNameProc2 *
+Tcl_ObjectGetMethodNameMapper2(
+    Tcl_Object object)
+{
+    return ((Object *) object)->mapMethodNameProc2;
+}
+
+void
+Tcl_ObjectSetMethodNameMapper2(
+    Tcl_Object object,
+    Tcl_ObjectMapMethodNameProc2 *mapMethodNameProc)
+{
+    Object *oPtr = (Object *) object;
+
+    oPtr->mapMethodNameProc2 = mapMethodNameProc;
+    oPtr->mapMethodNameProc = NULL;
+    ReleaseMappedNames(oPtr);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * MapMethodName --
+ *
+ *	Applies an object's (version 2) method name mapper, remembering the
+ *	result so that later calls of the same method on the object do not
+ *	need to map the name again until the object or the class system is
+ *	changed. Because the mapped name is kept, it also keeps the call chain
+ *	cached in it.
+ *
+ * Results:
+ *	A Tcl result code. On TCL_OK, the mapped name (not reference counted
+ *	for the caller) and start class are written to the variables pointed
+ *	to by mappedObjPtr and startClsPtr.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+MapMethodName(
+    Tcl_Interp *interp,
+    Object *oPtr,
+    Tcl_Obj *methodNameObj,
+    Tcl_Obj **mappedObjPtr,
+    Class **startClsPtr)
+{
+    Foundation *fPtr = oPtr->fPtr;
+    Tcl_HashEntry *hPtr;
+    MappedName *mapPtr;
+    Tcl_Obj *mappedObj = NULL;
+    Tcl_Class startCls = (Tcl_Class) *startClsPtr;
+    int isNew, result, remember = (startCls == NULL);
+
+    /*
+     * Only calls from the start of the chain are remembered; the others are
+     * rare enough to be not worth keeping.
+     */
+
+    if (remember && oPtr->mappedNameCache != NULL) {
+	hPtr = Tcl_FindHashEntry(oPtr->mappedNameCache, (char *)methodNameObj);
+	if (hPtr != NULL) {
+	    mapPtr = Tcl_GetHashValue(hPtr);
+	    if (mapPtr->epoch == fPtr->epoch
+		    && mapPtr->objectEpoch == oPtr->epoch) {
+		*mappedObjPtr = mapPtr->nameObj;
+		*startClsPtr = mapPtr->startCls;
+		return TCL_OK;
+	    }
+	}
+    }
+
+    result = oPtr->mapMethodNameProc2(interp, (Tcl_Object) oPtr,
+	    methodNameObj, &mappedObj, &startCls);
+    if (result != TCL_OK) {
+	return result;
+    }
+    if (mappedObj == NULL) {
+	mappedObj = methodNameObj;
+    }
+    *mappedObjPtr = mappedObj;
+    *startClsPtr = (Class *) startCls;
+
+    /*
+     * Remember the result. Note that the mapper may have done anything,
+     * including changing or deleting the object, so we look up the entry
+     * again.
+     */
+
+    if (!remember || Deleted(oPtr)) {
+	return TCL_OK;
+    }
+    if (oPtr->mappedNameCache == NULL) {
+	oPtr->mappedNameCache = (Tcl_HashTable *)
+		ckalloc(sizeof(Tcl_HashTable));
+	Tcl_InitObjHashTable(oPtr->mappedNameCache);
+    }
+    hPtr = Tcl_CreateHashEntry(oPtr->mappedNameCache, (char *) methodNameObj,
+	    &isNew);
+    if (isNew) {
+	mapPtr = (MappedName *) ckalloc(sizeof(MappedName));
+    } else {
+	mapPtr = Tcl_GetHashValue(hPtr);
+	Tcl_DecrRefCount(mapPtr->nameObj);
+	if (mapPtr->startCls != NULL) {
+	    DelRef(mapPtr->startCls);
+	}
+    }
+    mapPtr->nameObj = mappedObj;
+    Tcl_IncrRefCount(mappedObj);
+    mapPtr->startCls = (Class *) startCls;
+    if (mapPtr->startCls != NULL) {
+	AddRef(mapPtr->startCls);
+    }
+    mapPtr->epoch = fPtr->epoch;
+    mapPtr->objectEpoch = oPtr->epoch;
+    Tcl_SetHashValue(hPtr, mapPtr);
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ReleaseMappedNames --
+ *
+ *	Throws away all the remembered results of an object's method name
+ *	mapper.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+ReleaseMappedNames(
+    Object *oPtr)
+{
+    FOREACH_HASH_DECLS;
+    MappedName *mapPtr;
+
+    if (oPtr->mappedNameCache == NULL) {
+	return;
+    }
+    FOREACH_HASH_VALUE(mapPtr, oPtr->mappedNameCache) {
+	Tcl_DecrRefCount(mapPtr->nameObj);
+	if (mapPtr->startCls != NULL) {
+	    DelRef(mapPtr->startCls);
+	}
+	ckfree((char *) mapPtr);
+    }
+    Tcl_DeleteHashTable(oPtr->mappedNameCache);
+    ckfree((char *) oPtr->mappedNameCache);
+    oPtr->mappedNameCache = NULL;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * Tcl_ObjectGetWeakRef, Tcl_ObjectFromWeakRef --
+ *
+ *	Weak references to objects. A weak reference is the creationEpoch of
+ *	an object, which is never reused, and is resolved through the
+ *	foundation's table of weakly-referenced objects. Objects are only put
+ *	in that table once a weak reference to them is made, and are taken
+ *	out of it as they are deleted, so a reference to a deleted object
+ *	never touches the object's (possibly freed) memory.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Tcl_ObjectWeakRef
+Tcl_ObjectGetWeakRef(
+    Tcl_Object object)
+{
+    Object *oPtr = (Object *) object;
+    Tcl_ObjectWeakRef ref;
+    int isNew;
+
+    ref.id = oPtr->creationEpoch;
+    if (!(oPtr->flags & WEAKLY_REFERENCED) && !Deleted(oPtr)) {
+	Tcl_HashEntry *hPtr = Tcl_CreateHashEntry(&oPtr->fPtr->weakRefTable,
+		(char *) INT2PTR(oPtr->creationEpoch), &isNew);
+
+	Tcl_SetHashValue(hPtr, oPtr);
+	oPtr->flags |= WEAKLY_REFERENCED;
+    }
+    return ref;
+}
+
+Tcl_Object
+Tcl_ObjectFromWeakRef(
+    Tcl_Interp *interp,
+    Tcl_ObjectWeakRef ref)
+{
+    Foundation *fPtr = TclOOGetFoundation(interp);
+    Tcl_HashEntry *hPtr = Tcl_FindHashEntry(&fPtr->weakRefTable,
+	    (char *) INT2PTR(ref.id));
+    Object *oPtr;
+
+    if (hPtr == NULL) {
+	return NULL;
+    }
+    oPtr = Tcl_GetHashValue(hPtr);
+    if (Deleted(oPtr)) {
+	return NULL;
+    }
+    return (Tcl_Object) oPtr;
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -62,6 +62,16 @@ typedef struct Tcl_Class_ *Tcl_Class;
 typedef struct Tcl_Method_ *Tcl_Method;
 typedef struct Tcl_Object_ *Tcl_Object;
 typedef struct Tcl_ObjectContext_ *Tcl_ObjectContext;
+
+/*
+ * A weak reference to an object: something that can be used to find the
+ * object again for as long as it exists, without keeping it alive. See
+ * Tcl_ObjectGetWeakRef and Tcl_ObjectFromWeakRef.
+ */
+
+typedef struct {
+    int id;
+} Tcl_ObjectWeakRef;
 
 /*
  * Public datatypes for callbacks and structures used in the TIP#257 (OO)
@@ -77,6 +87,18 @@ typedef int (Tcl_CloneProc)(Tcl_Interp *interp, ClientData oldClientData,
 typedef void (Tcl_ObjectMetadataDeleteProc)(ClientData clientData);
 typedef int (Tcl_ObjectMapMethodNameProc)(Tcl_Interp *interp,
 	Tcl_Object object, Tcl_Class *startClsPtr, Tcl_Obj *methodNameObj);
+typedef int (Tcl_ObjectMapMethodNameProc2)(Tcl_Interp *interp,
+	Tcl_Object object, Tcl_Obj *methodNameObj,
+	Tcl_Obj **mappedNameObjPtr, Tcl_Class *startClsPtr);
+typedef int (Tcl_ClassInstanceProc)(ClientData clientData,
+	Tcl_Object object);
+
+/*
+ * Flag for Tcl_ClassForeachInstance: visit the instances of the subclasses
+ * of the class (and of the classes that mix it in) as well as its own.
+ */
+
+#define TCL_OO_INSTANCES_ALL	1
 
 /*
  * The type of a method implementation. This describes how to call the method
@@ -108,6 +130,73 @@ typedef struct {
  */
 
 #define TCL_OO_METHOD_VERSION_CURRENT 1
+
+/*
+ * Version 2 of the method type structure describes methods implemented in C
+ * whose arguments are checked and converted by TclOO before the method is
+ * called. The arguments are described by an array of Tcl_MethodArgSpec
+ * structures terminated by one whose type is TCL_OO_ARG_END; the converted
+ * values are passed to the call proc as an array of Tcl_MethodArg structures,
+ * one per declared argument. A pointer to a Tcl_MethodType2 may be passed
+ * (cast to const Tcl_MethodType *) anywhere a pointer to a Tcl_MethodType is
+ * accepted when creating a method.
+ */
+
+typedef struct {
+    int type;			/* One of the TCL_OO_ARG_* types below,
+				 * optionally ORed with TCL_OO_ARG_OPTIONAL. */
+    const char *name;		/* Name of the argument, for error messages. */
+    const char *defaultValue;	/* Value used when an optional argument is
+				 * omitted, or NULL if the argument is to be
+				 * left unset. */
+} Tcl_MethodArgSpec;
+
+#define TCL_OO_ARG_END		0 /* Terminates a list of argument specs. */
+#define TCL_OO_ARG_OBJ		1 /* Any value; only objPtr is set. */
+#define TCL_OO_ARG_INT		2 /* An integer; sets intValue. */
+#define TCL_OO_ARG_DOUBLE	3 /* A floating point number; sets
+				   * doubleValue. */
+#define TCL_OO_ARG_STRING	4 /* A string; sets stringValue and length. */
+#define TCL_OO_ARG_OBJECT	5 /* The name of an object; sets
+				   * objectValue. */
+#define TCL_OO_ARG_LIST		6 /* A list; sets length and elements. */
+#define TCL_OO_ARG_TYPE_MASK	0xff
+#define TCL_OO_ARG_OPTIONAL	0x100
+
+typedef struct {
+    Tcl_Obj *objPtr;		/* The argument as passed (or its default),
+				 * or NULL for an omitted optional argument
+				 * with no default, in which case all the
+				 * other fields are zero. */
+    int intValue;
+    double doubleValue;
+    const char *stringValue;
+    Tcl_Object objectValue;
+    int length;			/* Length of a string or list. */
+    Tcl_Obj **elements;		/* Elements of a list. */
+} Tcl_MethodArg;
+
+typedef int (Tcl_MethodCallProc2)(ClientData clientData, Tcl_Interp *interp,
+	Tcl_ObjectContext objectContext, int objc, Tcl_Obj *const *objv,
+	Tcl_MethodArg *args);
+
+typedef struct {
+    int version;		/* Always TCL_OO_METHOD_VERSION_2. */
+    const char *name;		/* Name of this type of method. */
+    Tcl_MethodCallProc2 *callProc;
+				/* How to invoke this method. It is only
+				 * called once the arguments have been
+				 * checked; objc and objv are the arguments
+				 * as seen (as for Tcl_MethodCallProc). */
+    Tcl_MethodDeleteProc *deleteProc;
+				/* As for Tcl_MethodType. */
+    Tcl_CloneProc *cloneProc;	/* As for Tcl_MethodType. */
+    const Tcl_MethodArgSpec *argSpecs;
+				/* Description of the arguments, terminated
+				 * by a TCL_OO_ARG_END entry. */
+} Tcl_MethodType2;
+
+#define TCL_OO_METHOD_VERSION_2 2
 
 /*
  * The type of some object (or class) metadata. This describes how to delete
@@ -15,6 +15,26 @@
 #endif
 #include "tclInt.h"
 #include "tclOOInt.h"
+
+static int		GetWeakRefFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr,
+			    Tcl_ObjectWeakRef *refPtr);
+static void		UpdateStringOfWeakRef(Tcl_Obj *objPtr);
+
+/*
+ * Object type used for the weak references made by [oo::weakref]. The
+ * internal representation is the id of the Tcl_ObjectWeakRef, which is also
+ * all that the string representation holds.
+ */
+
+static Tcl_ObjType weakRefType = {
+    "TclOO weak reference",
+    NULL,
+    NULL,
+    UpdateStringOfWeakRef,
+    NULL
+};
+
+#define WEAKREF_PREFIX "oo::weakref#"
 
 /*
  * ----------------------------------------------------------------------
@@ -1149,6 +1169,370 @@ TclOOCopyObjectCmd(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOPrecompileObjCmd --
+ *
+ *	Implementation of the [oo::precompile] command, which compiles the
+ *	bodies of the procedure-like methods of some classes (by default, all
+ *	classes) ahead of their first use. The result is a dictionary
+ *	describing how much work was done.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOOPrecompileObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    Foundation *fPtr = TclOOGetFoundation(interp);
+    TclOOCompileStats stats;
+    Class **classes;
+    Tcl_Object object;
+    Tcl_Obj *resultObj;
+    int i, numClasses, flags = 0, idx = 1;
+
+    if (objc > 1 && !strcmp(TclGetString(objv[1]), "-subclasses")) {
+	flags |= PRECOMPILE_SUBCLASSES;
+	idx++;
+    }
+
+    /*
+     * Work out which classes to process. No classes means all of them.
+     */
+
+    numClasses = objc - idx;
+    if (numClasses == 0) {
+	classes = (Class **) ckalloc(sizeof(Class *));
+	classes[0] = fPtr->objectCls;
+	numClasses = 1;
+	flags |= PRECOMPILE_SUBCLASSES;
+    } else {
+	classes = (Class **) ckalloc(sizeof(Class *) * numClasses);
+	for (i=0 ; i<numClasses ; i++) {
+	    object = Tcl_GetObjectFromObj(interp, objv[idx+i]);
+	    if (object == NULL) {
+		goto failed;
+	    }
+	    classes[i] = ((Object *) object)->classPtr;
+	    if (classes[i] == NULL) {
+		Tcl_AppendResult(interp, "\"", TclGetString(objv[idx+i]),
+			"\" is not a class", NULL);
+		Tcl_SetErrorCode(interp, "TCLOO", "NOT_CLASS", NULL);
+		goto failed;
+	    }
+	}
+    }
+
+    memset(&stats, 0, sizeof(TclOOCompileStats));
+    if (TclOOPrecompileClasses(interp, numClasses, classes, flags,
+	    &stats) != TCL_OK) {
+	goto failed;
+    }
+    ckfree((char *) classes);
+
+    resultObj = Tcl_NewObj();
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("methods",-1));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewIntObj(stats.numMethods));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("compiled",-1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewIntObj(stats.numCompiled));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("bytes", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(stats.codeBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("microseconds", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(stats.microseconds));
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+
+  failed:
+    ckfree((char *) classes);
+    return TCL_ERROR;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOProfileObjCmd --
+ *
+ *	Implementation of the [oo::profile] command, which controls the method
+ *	call profiler and reports what it has found.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOOProfileObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    static const char *options[] = {
+	"report", "start", "stop", NULL
+    };
+    enum Options {
+	PROFILE_REPORT, PROFILE_START, PROFILE_STOP
+    };
+    Foundation *fPtr = TclOOGetFoundation(interp);
+    int idx;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "option");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], options, "option", 0,
+	    &idx) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    switch ((enum Options) idx) {
+    case PROFILE_REPORT:
+	Tcl_SetObjResult(interp, TclOOProfileReport(interp));
+	break;
+    case PROFILE_START:
+	TclOOStartProfiling(fPtr);
+	break;
+    case PROFILE_STOP:
+	fPtr->profiling = 0;
+	break;
+    }
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOIsAObjCmd --
+ *
+ *	Implementation of the [oo::isa] command, a cheap test of whether an
+ *	object is an instance of a class (directly, by inheritance, or through
+ *	mixins). Things that are not objects are not instances of anything,
+ *	and nothing is an instance of something that is not a class, so the
+ *	only error is a wrong number of arguments.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOOIsAObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    Object *oPtr, *o2Ptr;
+    Class *mixinPtr;
+    int i, result = 0;
+
+    if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "objName className");
+	return TCL_ERROR;
+    }
+
+    oPtr = TclOOLookupObject(interp, objv[1]);
+    o2Ptr = TclOOLookupObject(interp, objv[2]);
+    if (oPtr == NULL || o2Ptr == NULL || o2Ptr->classPtr == NULL) {
+	goto done;
+    }
+    FOREACH(mixinPtr, oPtr->mixins) {
+	if (mixinPtr && TclOOIsReachable(o2Ptr->classPtr, mixinPtr)) {
+	    result = 1;
+	    goto done;
+	}
+    }
+    result = TclOOIsReachable(o2Ptr->classPtr, oPtr->selfCls);
+
+  done:
+    Tcl_SetObjResult(interp, Tcl_NewBooleanObj(result));
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOWeakRefObjCmd --
+ *
+ *	Implementation of the [oo::weakref] command, which makes and resolves
+ *	weak references to objects. Resolving one is a single hash lookup, and
+ *	a reference to an object that has been deleted simply fails to
+ *	resolve.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOOWeakRefObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    static const char *subcommands[] = {
+	"exists", "get", "new", NULL
+    };
+    enum WeakRefSubcmds {
+	WEAKREF_EXISTS, WEAKREF_GET, WEAKREF_NEW
+    };
+    Tcl_Object object;
+    Tcl_ObjectWeakRef ref;
+    Tcl_Obj *refObj;
+    int idx;
+
+    if (objc != 3) {
+	Tcl_WrongNumArgs(interp, 1, objv, "subcommand arg");
+	return TCL_ERROR;
+    }
+    if (Tcl_GetIndexFromObj(interp, objv[1], subcommands, "subcommand", 0,
+	    &idx) != TCL_OK) {
+	return TCL_ERROR;
+    }
+
+    if (idx == WEAKREF_NEW) {
+	object = Tcl_GetObjectFromObj(interp, objv[2]);
+	if (object == NULL) {
+	    return TCL_ERROR;
+	}
+	ref = Tcl_ObjectGetWeakRef(object);
+	refObj = Tcl_NewObj();
+	Tcl_InvalidateStringRep(refObj);
+	refObj->typePtr = &weakRefType;
+	refObj->internalRep.longValue = ref.id;
+	Tcl_SetObjResult(interp, refObj);
+	return TCL_OK;
+    }
+
+    if (GetWeakRefFromObj(interp, objv[2], &ref) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    object = Tcl_ObjectFromWeakRef(interp, ref);
+    if (idx == WEAKREF_EXISTS) {
+	Tcl_SetObjResult(interp, Tcl_NewBooleanObj(object != NULL));
+    } else if (object != NULL) {
+	Tcl_SetObjResult(interp, TclOOObjectName(interp, (Object *) object));
+    }
+    return TCL_OK;
+}
+
+static int
+GetWeakRefFromObj(
+    Tcl_Interp *interp,
+    Tcl_Obj *objPtr,
+    Tcl_ObjectWeakRef *refPtr)
+{
+    const char *str;
+    int id;
+
+    if (objPtr->typePtr == &weakRefType) {
+	refPtr->id = (int) objPtr->internalRep.longValue;
+	return TCL_OK;
+    }
+
+    str = Tcl_GetString(objPtr);
+    if (strncmp(str, WEAKREF_PREFIX, strlen(WEAKREF_PREFIX)) != 0
+	    || Tcl_GetInt(NULL, str + strlen(WEAKREF_PREFIX), &id) != TCL_OK) {
+	Tcl_AppendResult(interp, "bad weak reference \"", str, "\"", NULL);
+	Tcl_SetErrorCode(interp, "TCLOO", "VALUE", "WEAKREF", NULL);
+	return TCL_ERROR;
+    }
+    if (objPtr->typePtr != NULL && objPtr->typePtr->freeIntRepProc) {
+	objPtr->typePtr->freeIntRepProc(objPtr);
+    }
+    objPtr->typePtr = &weakRefType;
+    objPtr->internalRep.longValue = id;
+    refPtr->id = id;
+    return TCL_OK;
+}
+
+static void
+UpdateStringOfWeakRef(
+    Tcl_Obj *objPtr)
+{
+    char buf[TCL_INTEGER_SPACE + sizeof(WEAKREF_PREFIX)];
+    int len;
+
+    len = sprintf(buf, WEAKREF_PREFIX "%ld", objPtr->internalRep.longValue);
+    objPtr->bytes = ckalloc(len + 1);
+    memcpy(objPtr->bytes, buf, len + 1);
+    objPtr->length = len;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOStatsObjCmd --
+ *
+ *	Implementation of the [oo::stats] command, which describes how well
+ *	the call chain caches are working as a dictionary, and optionally
+ *	resets the counters afterwards.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+#define PUT_STAT(name, valueObj) \
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj(name, -1)); \
+    Tcl_ListObjAppendElement(NULL, resultObj, (valueObj))
+
+int
+TclOOStatsObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    static const char *causeNames[EPOCH_NUM_CAUSES] = {
+	"class", "constructor", "destructor", "export", "filter", "method",
+	"mixin", "superclass"
+    };
+    Foundation *fPtr = TclOOGetFoundation(interp);
+    TclOOStats *statsPtr = &fPtr->stats;
+    Tcl_Obj *resultObj, *bumpsObj;
+    int i;
+
+    if (objc > 2 || (objc == 2
+	    && strcmp(TclGetString(objv[1]), "-reset") != 0)) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?-reset?");
+	return TCL_ERROR;
+    }
+
+    bumpsObj = Tcl_NewObj();
+    for (i=0 ; i<EPOCH_NUM_CAUSES ; i++) {
+	Tcl_ListObjAppendElement(NULL, bumpsObj,
+		Tcl_NewStringObj(causeNames[i], -1));
+	Tcl_ListObjAppendElement(NULL, bumpsObj,
+		Tcl_NewWideIntObj(statsPtr->epochBumps[i]));
+    }
+
+    resultObj = Tcl_NewObj();
+    PUT_STAT("intrepHits", Tcl_NewWideIntObj(statsPtr->intrepHits));
+    PUT_STAT("objectCacheHits", Tcl_NewWideIntObj(statsPtr->objectCacheHits));
+    PUT_STAT("classCacheHits", Tcl_NewWideIntObj(statsPtr->classCacheHits));
+    PUT_STAT("shapeCacheHits", Tcl_NewWideIntObj(statsPtr->shapeCacheHits));
+    PUT_STAT("chainsBuilt", Tcl_NewWideIntObj(statsPtr->chainsBuilt));
+    PUT_STAT("unknownChains", Tcl_NewWideIntObj(statsPtr->unknownChains));
+    PUT_STAT("chainsFreed", Tcl_NewWideIntObj(statsPtr->chainsFreed));
+    PUT_STAT("epochAdvances", Tcl_NewWideIntObj(statsPtr->epochAdvances));
+    PUT_STAT("epochBumps", bumpsObj);
+    PUT_STAT("objects", Tcl_NewIntObj(fPtr->numObjects));
+    PUT_STAT("classes", Tcl_NewIntObj(fPtr->numClasses));
+    PUT_STAT("shapes", Tcl_NewIntObj(fPtr->shapeTable.numEntries));
+    PUT_STAT("chainCacheBytes", Tcl_NewWideIntObj(TclOOChainCacheSize(fPtr)));
+    Tcl_SetObjResult(interp, resultObj);
+
+    if (objc == 2) {
+	memset(statsPtr, 0, sizeof(TclOOStats));
+    }
+    return TCL_OK;
+}
+
+#undef PUT_STAT
+
 /*
  * Local Variables:
  * mode: c
@@ -30,6 +30,20 @@ struct ChainBuilder {
 				 * for. */
 };
 
+/*
+ * Structure describing a profiled method call that is in progress. These live
+ * on the C stack and are linked together so that the time spent in a call can
+ * be excluded from the exclusive time of its caller.
+ */
+
+struct ProfileFrame {
+    struct ProfileFrame *prevPtr;
+				/* The profiled call that made this one, or
+				 * NULL if there is none. */
+    Tcl_WideInt childTime;	/* Time spent in profiled calls made by this
+				 * one. */
+};
+
 /*
  * Extra flags used for call chain management.
  */
@@ -46,6 +60,8 @@ struct ChainBuilder {
 static void		AddClassFiltersToCallContext(Object *const oPtr,
 			    Class *clsPtr, struct ChainBuilder *const cbPtr,
 			    Tcl_HashTable *const doneFilters);
+static void		AddFilterPrefix(Object *const oPtr,
+			    struct ChainBuilder *const cbPtr);
 static void		AddClassMethodNames(Class *clsPtr, const int flags,
 			    Tcl_HashTable *const namesPtr);
 static inline void	AddMethodToCallChain(Method *const mPtr,
@@ -63,10 +79,15 @@ static void		AddSimpleClassChainToCallContext(Class *classPtr,
 			    Tcl_HashTable *const doneFilters, int flags,
 			    Class *const filterDecl);
 static int		CmpStr(const void *ptr1, const void *ptr2);
+static ObjectShape *	GetObjectShape(Object *oPtr);
 static void		DupMethodNameRep(Tcl_Obj *srcPtr, Tcl_Obj *dstPtr);
 static void		FreeMethodNameRep(Tcl_Obj *objPtr);
+static void		FreeProfileData(char *blockPtr);
 static inline int	IsStillValid(CallChain *callPtr, Object *oPtr,
 			    int flags, int reuseMask);
+static int		ProfiledInvoke(Tcl_Interp *interp,
+			    CallContext *contextPtr, Method *mPtr, int objc,
+			    Tcl_Obj *const *objv);
 static inline void	StashCallChain(Tcl_Obj *objPtr, CallChain *callPtr);
 
 /*
@@ -114,20 +135,23 @@ TclOODeleteContext(
  * ----------------------------------------------------------------------
  */
 
-void
+int
 TclOODeleteChainCache(
     Tcl_HashTable *tablePtr)
 {
     FOREACH_HASH_DECLS;
     CallChain *callPtr;
+    int count = 0;
 
     FOREACH_HASH_VALUE(callPtr, tablePtr) {
 	if (callPtr) {
 	    TclOODeleteChain(callPtr);
+	    count++;
 	}
     }
     Tcl_DeleteHashTable(tablePtr);
     ckfree((char *) tablePtr);
+    return count;
 }
 
 /*
@@ -150,6 +174,9 @@ TclOODeleteChain(
     if (callPtr->chain != callPtr->staticChain) {
 	ckfree((char *) callPtr->chain);
     }
+    if (callPtr->descObj != NULL) {
+	Tcl_DecrRefCount(callPtr->descObj);
+    }
     ckfree((char *) callPtr);
 }
 
@@ -284,11 +311,16 @@ TclOOInvokeContext(
     }
 
     /*
-     * Run the method implementation.
+     * Run the method implementation, going the long way round if we are
+     * gathering profiling data.
      */
 
-    result = mPtr->typePtr->callProc(mPtr->clientData, interp,
-	    (Tcl_ObjectContext) contextPtr, objc, objv);
+    if (!contextPtr->oPtr->fPtr->profiling) {
+	result = mPtr->typePtr->callProc(mPtr->clientData, interp,
+		(Tcl_ObjectContext) contextPtr, objc, objv);
+    } else {
+	result = ProfiledInvoke(interp, contextPtr, mPtr, objc, objv);
+    }
 
     /*
      * Restore the old filter-ness, release any locks on method
@@ -309,7 +341,261 @@ TclOOInvokeContext(
     }
     return result;
 }
-
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * ProfiledInvoke --
+ *
+ *	Invokes a single step along a method call-chain context while
+ *	recording how long it took and how it was reached. Only used while
+ *	profiling is enabled; see TclOOInvokeContext.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+ProfiledInvoke(
+    Tcl_Interp *interp,		/* Interpreter to invoke the method in. */
+    CallContext *contextPtr,	/* The method call context. */
+    Method *mPtr,		/* The method at the current step of the
+				 * context's call chain. */
+    int objc,			/* The number of arguments. */
+    Tcl_Obj *const *objv)	/* The arguments as actually seen. */
+{
+    Foundation *fPtr = contextPtr->oPtr->fPtr;
+    ProfileData *dataPtr = fPtr->profilePtr;
+    ProfileRecord *recPtr;
+    struct ProfileFrame frame;
+    Tcl_HashEntry *hPtr;
+    Tcl_Time start, end;
+    Tcl_WideInt elapsed;
+    int isNew, result;
+
+    /*
+     * Find (or make) the record for the method. The names are captured now,
+     * as the declarer might well have been deleted by the time the data is
+     * reported.
+     */
+
+    hPtr = Tcl_CreateHashEntry(&dataPtr->records, (char *) mPtr, &isNew);
+    if (isNew) {
+	Object *declarerPtr = (mPtr->declaringClassPtr != NULL
+		? mPtr->declaringClassPtr->thisPtr : mPtr->declaringObjectPtr);
+
+	recPtr = (ProfileRecord *) ckalloc(sizeof(ProfileRecord));
+	memset(recPtr, 0, sizeof(ProfileRecord));
+	recPtr->mPtr = mPtr;
+	AddRef(mPtr);
+	recPtr->declarerObj = TclOOObjectName(interp, declarerPtr);
+	Tcl_IncrRefCount(recPtr->declarerObj);
+	if (mPtr->namePtr != NULL) {
+	    recPtr->nameObj = mPtr->namePtr;
+	} else if (contextPtr->callPtr->flags & DESTRUCTOR) {
+	    recPtr->nameObj = fPtr->destructorName;
+	} else {
+	    recPtr->nameObj = fPtr->constructorName;
+	}
+	Tcl_IncrRefCount(recPtr->nameObj);
+	Tcl_SetHashValue(hPtr, recPtr);
+    } else {
+	recPtr = Tcl_GetHashValue(hPtr);
+    }
+
+    recPtr->calls++;
+    if (contextPtr->index > 0) {
+	recPtr->nextCalls++;
+	if (contextPtr->index > recPtr->maxDepth) {
+	    recPtr->maxDepth = contextPtr->index;
+	}
+    }
+    recPtr->active++;
+
+    /*
+     * Run the method implementation, timing it. The data is preserved in
+     * case profiling is restarted (which discards the old data) from inside
+     * the method.
+     */
+
+    Tcl_Preserve(dataPtr);
+    frame.prevPtr = dataPtr->framePtr;
+    frame.childTime = 0;
+    dataPtr->framePtr = &frame;
+
+    Tcl_GetTime(&start);
+    result = mPtr->typePtr->callProc(mPtr->clientData, interp,
+	    (Tcl_ObjectContext) contextPtr, objc, objv);
+    Tcl_GetTime(&end);
+
+    elapsed = ((Tcl_WideInt) end.sec - start.sec) * 1000000
+	    + (end.usec - start.usec);
+    dataPtr->framePtr = frame.prevPtr;
+    if (frame.prevPtr != NULL) {
+	frame.prevPtr->childTime += elapsed;
+    }
+    recPtr->exclusive += elapsed - frame.childTime;
+    if (--recPtr->active == 0) {
+	recPtr->inclusive += elapsed;
+    }
+    Tcl_Release(dataPtr);
+    return result;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOStartProfiling, TclOODeleteProfileData, FreeProfileData --
+ *
+ *	Manage the lifetime of the data gathered by the method call profiler.
+ *	Starting profiling discards whatever data was gathered by the previous
+ *	profiling run.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+void
+TclOOStartProfiling(
+    Foundation *fPtr)
+{
+    if (fPtr->profilePtr != NULL) {
+	TclOODeleteProfileData(fPtr->profilePtr);
+    }
+    fPtr->profilePtr = (ProfileData *) ckalloc(sizeof(ProfileData));
+    Tcl_InitHashTable(&fPtr->profilePtr->records, TCL_ONE_WORD_KEYS);
+    fPtr->profilePtr->framePtr = NULL;
+    fPtr->profiling = 1;
+}
+
+void
+TclOODeleteProfileData(
+    ProfileData *dataPtr)
+{
+    Tcl_EventuallyFree(dataPtr, FreeProfileData);
+}
+
+static void
+FreeProfileData(
+    char *blockPtr)
+{
+    ProfileData *dataPtr = (ProfileData *) blockPtr;
+    ProfileRecord *recPtr;
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+
+    for (hPtr = Tcl_FirstHashEntry(&dataPtr->records, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	recPtr = Tcl_GetHashValue(hPtr);
+	TclOODelMethodRef(recPtr->mPtr);
+	Tcl_DecrRefCount(recPtr->declarerObj);
+	Tcl_DecrRefCount(recPtr->nameObj);
+	ckfree((char *) recPtr);
+    }
+    Tcl_DeleteHashTable(&dataPtr->records);
+    ckfree((char *) dataPtr);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOProfileReport --
+ *
+ *	Describes the data gathered by the most recent profiling run as a
+ *	dictionary, mapping the names of the declaring classes and objects to
+ *	dictionaries that map method names to the statistics for the method.
+ *	Records for different methods with the same declarer and method name
+ *	are merged. The result has a reference count of zero.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Tcl_Obj *
+TclOOProfileReport(
+    Tcl_Interp *interp)
+{
+    ProfileData *dataPtr = TclOOGetFoundation(interp)->profilePtr;
+    Tcl_Obj *resultObj = Tcl_NewObj(), *statsObj, *keyObj, *keyv[2];
+    ProfileRecord *recPtr, *sumPtr;
+    Tcl_HashTable sums;		/* Map from the list of the declarer and
+				 * method name to the merged statistics. */
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr, *sumHPtr;
+    int isNew;
+
+    if (dataPtr == NULL) {
+	return resultObj;
+    }
+
+    /*
+     * Records are per method, but the report is per declarer and method
+     * name, so a method that was redefined (or a declarer that was replaced
+     * by another of the same name) has several records for one key. Merge
+     * them first: sum the counts and times, and take the deepest call.
+     */
+
+    Tcl_InitObjHashTable(&sums);
+    for (hPtr = Tcl_FirstHashEntry(&dataPtr->records, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	recPtr = Tcl_GetHashValue(hPtr);
+	keyv[0] = recPtr->declarerObj;
+	keyv[1] = recPtr->nameObj;
+	keyObj = Tcl_NewListObj(2, keyv);
+	Tcl_IncrRefCount(keyObj);
+	sumHPtr = Tcl_CreateHashEntry(&sums, (char *) keyObj, &isNew);
+	Tcl_DecrRefCount(keyObj);
+	if (isNew) {
+	    sumPtr = (ProfileRecord *) ckalloc(sizeof(ProfileRecord));
+	    *sumPtr = *recPtr;
+	    Tcl_SetHashValue(sumHPtr, sumPtr);
+	    continue;
+	}
+	sumPtr = Tcl_GetHashValue(sumHPtr);
+	sumPtr->calls += recPtr->calls;
+	sumPtr->inclusive += recPtr->inclusive;
+	sumPtr->exclusive += recPtr->exclusive;
+	sumPtr->nextCalls += recPtr->nextCalls;
+	if (recPtr->maxDepth > sumPtr->maxDepth) {
+	    sumPtr->maxDepth = recPtr->maxDepth;
+	}
+    }
+
+    /*
+     * Now describe each merged record. The names in the merged records
+     * belong to the profile records they were copied from.
+     */
+
+    for (hPtr = Tcl_FirstHashEntry(&sums, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	sumPtr = Tcl_GetHashValue(hPtr);
+	statsObj = Tcl_NewObj();
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewStringObj("calls", -1));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewWideIntObj(sumPtr->calls));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewStringObj("inclusive", -1));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewWideIntObj(sumPtr->inclusive));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewStringObj("exclusive", -1));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewWideIntObj(sumPtr->exclusive));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewStringObj("nextcalls", -1));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewWideIntObj(sumPtr->nextCalls));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewStringObj("maxdepth", -1));
+	Tcl_ListObjAppendElement(NULL, statsObj,
+		Tcl_NewIntObj(sumPtr->maxDepth));
+	keyv[0] = sumPtr->declarerObj;
+	keyv[1] = sumPtr->nameObj;
+	Tcl_DictObjPutKeyList(NULL, resultObj, 2, keyv, statsObj);
+	ckfree((char *) sumPtr);
+    }
+    Tcl_DeleteHashTable(&sums);
+    return resultObj;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -801,16 +1087,24 @@ InitCallChain(
 {
     callPtr->flags = flags &
 	    (PUBLIC_METHOD | PRIVATE_METHOD | SPECIAL | FILTER_HANDLING);
-    if (oPtr->flags & USE_CLASS_CACHE) {
-	oPtr = oPtr->selfCls->thisPtr;
-	callPtr->flags |= USE_CLASS_CACHE;
-    }
     callPtr->epoch = oPtr->fPtr->epoch;
-    callPtr->objectCreationEpoch = oPtr->creationEpoch;
-    callPtr->objectEpoch = oPtr->epoch;
+    if (!(oPtr->flags & USE_CLASS_CACHE) && !(flags & SPECIAL)
+	    && oPtr->shapePtr != NULL) {
+	callPtr->flags |= USE_SHAPE_CACHE;
+	callPtr->objectCreationEpoch = oPtr->shapePtr->id;
+	callPtr->objectEpoch = 0;
+    } else {
+	if (oPtr->flags & USE_CLASS_CACHE) {
+	    oPtr = oPtr->selfCls->thisPtr;
+	    callPtr->flags |= USE_CLASS_CACHE;
+	}
+	callPtr->objectCreationEpoch = oPtr->creationEpoch;
+	callPtr->objectEpoch = oPtr->epoch;
+    }
     callPtr->refCount = 1;
     callPtr->numChain = 0;
     callPtr->chain = callPtr->staticChain;
+    callPtr->descObj = NULL;
 }
 
 /*
@@ -825,6 +1119,10 @@ InitCallChain(
  *	- Still across the same object strucutre (same local epoch), and
  *	- No public/private/filter magic leakage (same flags, modulo the fact
  *	  that a public chain will satisfy a non-public call).
+ *	Chains built for an object shape are instead checked against the
+ *	shape's identity, the global epoch and the flags. The object's own
+ *	epoch does not need checking, as any change to the object detaches it
+ *	from its shape.
  *
  * ----------------------------------------------------------------------
  */
@@ -839,6 +1137,11 @@ IsStillValid(
     if ((oPtr->flags & USE_CLASS_CACHE)) {
 	oPtr = oPtr->selfCls->thisPtr;
 	flags |= USE_CLASS_CACHE;
+    } else if (oPtr->shapePtr != NULL) {
+	flags |= USE_SHAPE_CACHE;
+	return ((callPtr->objectCreationEpoch == oPtr->shapePtr->id)
+		&& (callPtr->epoch == oPtr->fPtr->epoch)
+		&& ((callPtr->flags & mask) == (flags & mask)));
     }
     return ((callPtr->objectCreationEpoch == oPtr->creationEpoch)
 	    && (callPtr->epoch == oPtr->fPtr->epoch)
@@ -874,10 +1177,11 @@ TclOOGetCallContext(
     struct ChainBuilder cb;
     int i, count, doFilters;
     Tcl_HashEntry *hPtr;
-    Tcl_HashTable doneFilters;
+    Tcl_HashTable **cachePtrPtr;
 
-    if (flags&(SPECIAL|FILTER_HANDLING) || (oPtr->flags&FILTER_HANDLING)) {
-	hPtr = NULL;
+    hPtr = NULL;
+    cachePtrPtr = NULL;
+    if (flags & SPECIAL) {
 	doFilters = 0;
 
 	/*
@@ -890,6 +1194,7 @@ TclOOGetCallContext(
 		    && (callPtr->objectEpoch == oPtr->selfCls->thisPtr->epoch)
 		    && (callPtr->epoch == oPtr->fPtr->epoch)) {
 		callPtr->refCount++;
+		oPtr->fPtr->stats.classCacheHits++;
 		goto returnContext;
 	    }
 	} else if (flags & DESTRUCTOR) {
@@ -898,6 +1203,7 @@ TclOOGetCallContext(
 		    && (callPtr->objectEpoch == oPtr->selfCls->thisPtr->epoch)
 		    && (callPtr->epoch == oPtr->fPtr->epoch)) {
 		callPtr->refCount++;
+		oPtr->fPtr->stats.classCacheHits++;
 		goto returnContext;
 	    }
 	}
@@ -907,50 +1213,71 @@ TclOOGetCallContext(
 	 * of the cache. This is made a bit more complex by the fact that
 	 * there are multiple different layers of cache (in the Tcl_Obj, in
 	 * the object, and in the class).
+	 *
+	 * Calls made while a filter is running skip the filters, so their
+	 * chains are different from those of ordinary calls. They are kept in
+	 * caches of their own, and never in the Tcl_Obj, so that the two sorts
+	 * of call do not keep evicting each other's chains.
 	 */
 
-	const int reuseMask = ((flags & PUBLIC_METHOD) ? ~0 : ~PUBLIC_METHOD);
+	ObjectShape *shapePtr = NULL;
+	int reuseMask;
 
-	if (methodNameObj->typePtr == &methodNameType) {
+	if (oPtr->flags & FILTER_HANDLING) {
+	    flags |= FILTER_HANDLING;
+	}
+	if (!(oPtr->flags & USE_CLASS_CACHE)) {
+	    shapePtr = GetObjectShape(oPtr);
+	}
+	reuseMask = ((flags & PUBLIC_METHOD) ? ~0 : ~PUBLIC_METHOD);
+	doFilters = !(flags & FILTER_HANDLING);
+
+	if (doFilters && methodNameObj->typePtr == &methodNameType) {
 	    callPtr = methodNameObj->internalRep.otherValuePtr;
 	    if (IsStillValid(callPtr, oPtr, flags, reuseMask)) {
 		callPtr->refCount++;
+		oPtr->fPtr->stats.intrepHits++;
 		goto returnContext;
 	    }
 	    methodNameObj->typePtr->freeIntRepProc(methodNameObj);
 	}
 
 	if (oPtr->flags & USE_CLASS_CACHE) {
-	    if (oPtr->selfCls->classChainCache != NULL) {
-		hPtr = Tcl_FindHashEntry(oPtr->selfCls->classChainCache,
-			(char *) methodNameObj);
-	    } else {
-		hPtr = NULL;
-	    }
+	    cachePtrPtr = (doFilters ? &oPtr->selfCls->classChainCache
+		    : &oPtr->selfCls->unfilteredChainCache);
+	} else if (shapePtr != NULL) {
+	    cachePtrPtr = (doFilters ? &shapePtr->chainCache
+		    : &shapePtr->unfilteredChainCache);
 	} else {
-	    if (oPtr->chainCache != NULL) {
-		hPtr = Tcl_FindHashEntry(oPtr->chainCache,
-			(char *) methodNameObj);
-	    } else {
-		hPtr = NULL;
-	    }
+	    cachePtrPtr = (doFilters ? &oPtr->chainCache
+		    : &oPtr->unfilteredChainCache);
+	}
+	if (*cachePtrPtr != NULL) {
+	    hPtr = Tcl_FindHashEntry(*cachePtrPtr, (char *) methodNameObj);
 	}
 
 	if (hPtr != NULL && Tcl_GetHashValue(hPtr) != NULL) {
 	    callPtr = Tcl_GetHashValue(hPtr);
 	    if (IsStillValid(callPtr, oPtr, flags, reuseMask)) {
 		callPtr->refCount++;
+		if (oPtr->flags & USE_CLASS_CACHE) {
+		    oPtr->fPtr->stats.classCacheHits++;
+		} else if (shapePtr != NULL) {
+		    oPtr->fPtr->stats.shapeCacheHits++;
+		} else {
+		    oPtr->fPtr->stats.objectCacheHits++;
+		}
 		goto returnContext;
 	    }
 	    Tcl_SetHashValue(hPtr, NULL);
 	    TclOODeleteChain(callPtr);
+	    oPtr->fPtr->stats.chainsFreed++;
 	}
-
-	doFilters = 1;
     }
 
     callPtr = (CallChain *) ckalloc(sizeof(CallChain));
     InitCallChain(callPtr, oPtr, flags);
+    oPtr->fPtr->stats.chainsBuilt++;
 
     cb.callChainPtr = callPtr;
     cb.filterLength = 0;
@@ -965,6 +1292,7 @@ TclOOGetCallContext(
 		&cb, NULL, 0, NULL);
 	callPtr->flags |= OO_UNKNOWN_METHOD;
 	callPtr->epoch = -1;
+	oPtr->fPtr->stats.unknownChains++;
 	if (callPtr->numChain == 0) {
 	    TclOODeleteChain(callPtr);
 	    return NULL;
@@ -979,20 +1307,7 @@ TclOOGetCallContext(
      */
 
     if (doFilters) {
-	Tcl_Obj *filterObj;
-	Class *mixinPtr;
-
-	doFilters = 1;
-	Tcl_InitObjHashTable(&doneFilters);
-	FOREACH(mixinPtr, oPtr->mixins) {
-	    AddClassFiltersToCallContext(oPtr, mixinPtr, &cb, &doneFilters);
-	}
-	FOREACH(filterObj, oPtr->filters) {
-	    AddSimpleChainToCallContext(oPtr, filterObj, &cb, &doneFilters, 0,
-		    NULL);
-	}
-	AddClassFiltersToCallContext(oPtr, oPtr->selfCls, &cb, &doneFilters);
-	Tcl_DeleteHashTable(&doneFilters);
+	AddFilterPrefix(oPtr, &cb);
     }
     count = cb.filterLength = callPtr->numChain;
 
@@ -1022,44 +1337,38 @@ TclOOGetCallContext(
 		&cb, NULL, 0, NULL);
 	callPtr->flags |= OO_UNKNOWN_METHOD;
 	callPtr->epoch = -1;
+	oPtr->fPtr->stats.unknownChains++;
 	if (count == callPtr->numChain) {
 	    TclOODeleteChain(callPtr);
 	    return NULL;
 	}
-    } else if (doFilters) {
+    } else if (cachePtrPtr != NULL) {
 	if (hPtr == NULL) {
-	    if (oPtr->flags & USE_CLASS_CACHE) {
-		if (oPtr->selfCls->classChainCache == NULL) {
-		    oPtr->selfCls->classChainCache = (Tcl_HashTable *)
-			    ckalloc(sizeof(Tcl_HashTable));
-
-		    Tcl_InitObjHashTable(oPtr->selfCls->classChainCache);
-		}
-		hPtr = Tcl_CreateHashEntry(oPtr->selfCls->classChainCache,
-			(char *) methodNameObj, &i);
-	    } else {
-		if (oPtr->chainCache == NULL) {
-		    oPtr->chainCache = (Tcl_HashTable *)
-			    ckalloc(sizeof(Tcl_HashTable));
+	    if (*cachePtrPtr == NULL) {
+		*cachePtrPtr = (Tcl_HashTable *)
+			ckalloc(sizeof(Tcl_HashTable));
 
-		    Tcl_InitObjHashTable(oPtr->chainCache);
-		}
-		hPtr = Tcl_CreateHashEntry(oPtr->chainCache,
-			(char *) methodNameObj, &i);
+		Tcl_InitObjHashTable(*cachePtrPtr);
 	    }
+	    hPtr = Tcl_CreateHashEntry(*cachePtrPtr, (char *) methodNameObj,
+		    &i);
 	}
 	callPtr->refCount++;
 	Tcl_SetHashValue(hPtr, callPtr);
-	StashCallChain(methodNameObj, callPtr);
+	if (doFilters) {
+	    StashCallChain(methodNameObj, callPtr);
+	}
     } else if (flags & CONSTRUCTOR) {
 	if (oPtr->selfCls->constructorChainPtr) {
 	    TclOODeleteChain(oPtr->selfCls->constructorChainPtr);
+	    oPtr->fPtr->stats.chainsFreed++;
 	}
 	oPtr->selfCls->constructorChainPtr = callPtr;
 	callPtr->refCount++;
     } else if ((flags & DESTRUCTOR) && oPtr->mixins.num == 0) {
 	if (oPtr->selfCls->destructorChainPtr) {
 	    TclOODeleteChain(oPtr->selfCls->destructorChainPtr);
+	    oPtr->fPtr->stats.chainsFreed++;
 	}
 	oPtr->selfCls->destructorChainPtr = callPtr;
 	callPtr->refCount++;
@@ -1075,6 +1384,203 @@ TclOOGetCallContext(
     return contextPtr;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * GetObjectShape --
+ *
+ *	Works out the shape of an object whose dispatch is changed only by
+ *	mixins and filters, so that it can share call chains with all other
+ *	objects with the same class, mixins and filters. The shape is
+ *	remembered in the object until the object is next changed (see
+ *	TclOOObjectChanged), and is worked out again when the object is next
+ *	called. Returns NULL if the object cannot have a shape, which is the
+ *	case when it has methods of its own.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static ObjectShape *
+GetObjectShape(
+    Object *oPtr)
+{
+    Foundation *fPtr = oPtr->fPtr;
+    ObjectShape *shapePtr = oPtr->shapePtr;
+    Tcl_HashEntry *hPtr;
+    Tcl_DString key;
+    Class *mixinPtr;
+    Tcl_Obj *filterObj;
+    char buf[TCL_INTEGER_SPACE + 1];
+    int i, isNew;
+
+    if (shapePtr != NULL) {
+	return shapePtr;
+    }
+    if (oPtr->methodsPtr != NULL && oPtr->methodsPtr->numEntries > 0) {
+	return NULL;
+    }
+
+    /*
+     * Describe the shape. Classes are identified by the creation epochs of
+     * their objects rather than by address so that a deleted class can never
+     * be mistaken for a new one.
+     */
+
+    Tcl_DStringInit(&key);
+    sprintf(buf, "%d", oPtr->selfCls->thisPtr->creationEpoch);
+    Tcl_DStringAppendElement(&key, buf);
+    sprintf(buf, "%d", oPtr->mixins.num);
+    Tcl_DStringAppendElement(&key, buf);
+    FOREACH(mixinPtr, oPtr->mixins) {
+	sprintf(buf, "%d", mixinPtr ? mixinPtr->thisPtr->creationEpoch : 0);
+	Tcl_DStringAppendElement(&key, buf);
+    }
+    FOREACH(filterObj, oPtr->filters) {
+	Tcl_DStringAppendElement(&key, TclGetString(filterObj));
+    }
+
+    hPtr = Tcl_CreateHashEntry(&fPtr->shapeTable, Tcl_DStringValue(&key),
+	    &isNew);
+    Tcl_DStringFree(&key);
+    if (isNew) {
+	shapePtr = (ObjectShape *) ckalloc(sizeof(ObjectShape));
+	memset(shapePtr, 0, sizeof(ObjectShape));
+	shapePtr->hPtr = hPtr;
+	shapePtr->id = ++fPtr->shapeCount;
+	Tcl_SetHashValue(hPtr, shapePtr);
+    } else {
+	shapePtr = Tcl_GetHashValue(hPtr);
+    }
+    shapePtr->refCount++;
+    oPtr->shapePtr = shapePtr;
+    return shapePtr;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOReleaseShape --
+ *
+ *	Detaches an object from its shape, deleting the shape and its caches
+ *	if no other object has it.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+void
+TclOOReleaseShape(
+    Object *oPtr)
+{
+    ObjectShape *shapePtr = oPtr->shapePtr;
+
+    if (shapePtr == NULL) {
+	return;
+    }
+    oPtr->shapePtr = NULL;
+    if (--shapePtr->refCount > 0) {
+	return;
+    }
+
+    Tcl_DeleteHashEntry(shapePtr->hPtr);
+    if (shapePtr->chainCache != NULL) {
+	oPtr->fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(shapePtr->chainCache);
+    }
+    if (shapePtr->unfilteredChainCache != NULL) {
+	oPtr->fPtr->stats.chainsFreed +=
+		TclOODeleteChainCache(shapePtr->unfilteredChainCache);
+    }
+    TclOODeleteChain(shapePtr->filterChainPtr[0]);
+    TclOODeleteChain(shapePtr->filterChainPtr[1]);
+    ckfree((char *) shapePtr);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * AddFilterPrefix --
+ *
+ *	Adds the filters that apply to an object to the start of a call chain
+ *	that is being built. Resolving the filters is costly, and the result
+ *	does not depend on the method being called, so it is built once per
+ *	(object, epoch) and kept in the object (or in its class or shape,
+ *	when the object shares their chain cache) to be copied into each new
+ *	chain.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+AddFilterPrefix(
+    Object *const oPtr,		/* Object that the filters operate on. */
+    struct ChainBuilder *const cbPtr)
+				/* Context to fill with call chain entries.
+				 * Must be empty. */
+{
+    CallChain *callPtr = cbPtr->callChainPtr;
+    CallChain *prefixPtr, **prefixPtrPtr;
+    int flags = callPtr->flags & PRIVATE_METHOD;
+
+    if (oPtr->flags & USE_CLASS_CACHE) {
+	prefixPtrPtr = &oPtr->selfCls->filterChainPtr[flags ? 1 : 0];
+    } else if (oPtr->shapePtr != NULL) {
+	prefixPtrPtr = &oPtr->shapePtr->filterChainPtr[flags ? 1 : 0];
+    } else {
+	prefixPtrPtr = &oPtr->filterChainPtr[flags ? 1 : 0];
+    }
+    prefixPtr = *prefixPtrPtr;
+
+    if (prefixPtr == NULL || !IsStillValid(prefixPtr, oPtr, flags,
+	    PRIVATE_METHOD | USE_CLASS_CACHE | USE_SHAPE_CACHE)) {
+	struct ChainBuilder fb;
+	Tcl_HashTable doneFilters;
+	Tcl_Obj *filterObj;
+	Class *mixinPtr;
+	int i;
+
+	if (prefixPtr != NULL) {
+	    TclOODeleteChain(prefixPtr);
+	    *prefixPtrPtr = NULL;
+	}
+
+	prefixPtr = (CallChain *) ckalloc(sizeof(CallChain));
+	InitCallChain(prefixPtr, oPtr, flags);
+	fb.callChainPtr = prefixPtr;
+	fb.filterLength = 0;
+	fb.oPtr = oPtr;
+
+	Tcl_InitObjHashTable(&doneFilters);
+	FOREACH(mixinPtr, oPtr->mixins) {
+	    AddClassFiltersToCallContext(oPtr, mixinPtr, &fb, &doneFilters);
+	}
+	FOREACH(filterObj, oPtr->filters) {
+	    AddSimpleChainToCallContext(oPtr, filterObj, &fb, &doneFilters, 0,
+		    NULL);
+	}
+	AddClassFiltersToCallContext(oPtr, oPtr->selfCls, &fb, &doneFilters);
+	Tcl_DeleteHashTable(&doneFilters);
+
+	/*
+	 * Only remember prefixes that have something in them; objects without
+	 * filters are common and resolving their (lack of) filters is cheap.
+	 */
+
+	if (prefixPtr->numChain == 0) {
+	    TclOODeleteChain(prefixPtr);
+	    return;
+	}
+	*prefixPtrPtr = prefixPtr;
+    }
+
+    if (prefixPtr->numChain > CALL_CHAIN_STATIC_SIZE) {
+	callPtr->chain = (struct MInvoke *)
+		ckalloc(sizeof(struct MInvoke) * prefixPtr->numChain);
+    }
+    memcpy(callPtr->chain, prefixPtr->chain,
+	    sizeof(struct MInvoke) * prefixPtr->numChain);
+    callPtr->numChain = prefixPtr->numChain;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1134,10 +1640,12 @@ TclOOGetStereotypeCallChain(
 	    callPtr = Tcl_GetHashValue(hPtr);
 	    if (IsStillValid(callPtr, &obj, flags, reuseMask)) {
 		callPtr->refCount++;
+		fPtr->stats.classCacheHits++;
 		return callPtr;
 	    }
 	    Tcl_SetHashValue(hPtr, NULL);
 	    TclOODeleteChain(callPtr);
+	    fPtr->stats.chainsFreed++;
 	}
     } else {
 	hPtr = NULL;
@@ -1151,6 +1659,7 @@ TclOOGetStereotypeCallChain(
     callPtr->objectEpoch = clsPtr->thisPtr->epoch;
     callPtr->refCount = 1;
     callPtr->chain = callPtr->staticChain;
+    fPtr->stats.chainsBuilt++;
 
     cb.callChainPtr = callPtr;
     cb.filterLength = 0;
@@ -1184,6 +1693,7 @@ TclOOGetStereotypeCallChain(
 		NULL, 0, NULL);
 	callPtr->flags |= OO_UNKNOWN_METHOD;
 	callPtr->epoch = -1;
+	fPtr->stats.unknownChains++;
 	if (count == callPtr->numChain) {
 	    TclOODeleteChain(callPtr);
 	    return NULL;
@@ -1371,7 +1881,9 @@ AddSimpleClassChainToCallContext(
  * TclOORenderCallChain --
  *
  *	Create a description of a call chain. Used in [info object call],
- *	[info class call], and [self call].
+ *	[info class call], and [self call]. Call chains do not change once
+ *	built, so the description is remembered on the chain and handed out
+ *	again until some class is renamed.
  *
  * ----------------------------------------------------------------------
  */
@@ -1381,21 +1893,17 @@ TclOORenderCallChain(
     Tcl_Interp *interp,
     CallChain *callPtr)
 {
-    Tcl_Obj *filterLiteral, *methodLiteral, *objectLiteral;
-    Tcl_Obj *resultObj, *descObjs[4], **objv;
+    Tcl_Obj *descObjs[4], **objv;
     Foundation *fPtr = TclOOGetFoundation(interp);
     int i;
 
-    /*
-     * Allocate the literals (potentially) used in our description.
-     */
-
-    filterLiteral = Tcl_NewStringObj("filter", -1);
-    Tcl_IncrRefCount(filterLiteral);
-    methodLiteral = Tcl_NewStringObj("method", -1);
-    Tcl_IncrRefCount(methodLiteral);
-    objectLiteral = Tcl_NewStringObj("object", -1);
-    Tcl_IncrRefCount(objectLiteral);
+    if (callPtr->descObj != NULL) {
+	if (callPtr->descEpoch == fPtr->classNameEpoch) {
+	    return callPtr->descObj;
+	}
+	Tcl_DecrRefCount(callPtr->descObj);
+	callPtr->descObj = NULL;
+    }
 
     /*
      * Do the actual construction of the descriptions. They consist of a list
@@ -1406,7 +1914,8 @@ TclOORenderCallChain(
      * special because it's a filter method). The second word is the name of
      * the method in question (which differs for "unknown" and "filter" types)
      * and the third word is the full name of the class that declares the
-     * method (or "object" if it is declared on the instance).
+     * method (or "object" if it is declared on the instance). The literal
+     * words are shared from the foundation.
      */
 
     objv = TclStackAlloc(interp, callPtr->numChain * sizeof(Tcl_Obj *));
@@ -1414,10 +1923,10 @@ TclOORenderCallChain(
 	struct MInvoke *miPtr = &callPtr->chain[i];
 
 	descObjs[0] = miPtr->isFilter
-		? filterLiteral
+		? fPtr->filterLiteral
 		: callPtr->flags & OO_UNKNOWN_METHOD
 			? fPtr->unknownMethodNameObj
-			: methodLiteral;
+			: fPtr->methodLiteral;
 	descObjs[1] = callPtr->flags & CONSTRUCTOR
 		? fPtr->constructorName
 		: callPtr->flags & DESTRUCTOR
@@ -1426,30 +1935,160 @@ TclOORenderCallChain(
 	descObjs[2] = miPtr->mPtr->declaringClassPtr
 		? Tcl_GetObjectName(interp,
 			(Tcl_Object) miPtr->mPtr->declaringClassPtr->thisPtr)
-		: objectLiteral;
-	descObjs[3] = Tcl_NewStringObj(miPtr->mPtr->typePtr->name, -1);
+		: fPtr->objectLiteral;
+	descObjs[3] = Tcl_NewStringObj(TclOOMethodTypeName(miPtr->mPtr),-1);
 
 	objv[i] = Tcl_NewListObj(4, descObjs);
     }
 
     /*
-     * Drop the local references to the literals; if they're actually used,
-     * they'll live on the description itself.
+     * Finish building the description, remember it, and return it.
      */
 
-    Tcl_DecrRefCount(filterLiteral);
-    Tcl_DecrRefCount(methodLiteral);
-    Tcl_DecrRefCount(objectLiteral);
+    callPtr->descObj = Tcl_NewListObj(callPtr->numChain, objv);
+    Tcl_IncrRefCount(callPtr->descObj);
+    callPtr->descEpoch = fPtr->classNameEpoch;
+    TclStackFree(interp, objv);
+    return callPtr->descObj;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOChainCacheSize, TclOOChainTableSize, TclOOChainSize --
+ *
+ *	Compute the approximate number of bytes of memory used by call chains.
+ *	TclOOChainCacheSize does this for all the caches of all the classes and
+ *	objects of an interpreter; it walks the whole class graph and the
+ *	instances of each class, so it is only suitable for occasional use.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Tcl_WideInt
+TclOOChainCacheSize(
+    Foundation *fPtr)
+{
+    FOREACH_HASH_DECLS;
+    Tcl_HashTable doneTable;
+    Class **stack, *clsPtr, *subPtr;
+    Object *instancePtr;
+    ObjectShape *shapePtr;
+    int i, isNew, depth = 0, stackSize = 16;
+    Tcl_WideInt size = 0;
 
     /*
-     * Finish building the description and return it.
+     * The root objects are not instances of anything, so they have to be
+     * done specially. Everything else is reachable as a subclass of the root
+     * class, or as an instance (in the sense of [info class instances]) of
+     * such a subclass. The caches shared between objects of the same shape
+     * are in the foundation.
      */
 
-    resultObj = Tcl_NewListObj(callPtr->numChain, objv);
-    TclStackFree(interp, objv);
-    return resultObj;
+    size += TclOOChainTableSize(fPtr->objectCls->thisPtr->chainCache);
+    size += TclOOChainTableSize(fPtr->classCls->thisPtr->chainCache);
+    size += TclOOChainTableSize(
+	    fPtr->objectCls->thisPtr->unfilteredChainCache);
+    size += TclOOChainTableSize(
+	    fPtr->classCls->thisPtr->unfilteredChainCache);
+
+    FOREACH_HASH_VALUE(shapePtr, &fPtr->shapeTable) {
+	size += sizeof(ObjectShape)
+		+ TclOOChainTableSize(shapePtr->chainCache)
+		+ TclOOChainTableSize(shapePtr->unfilteredChainCache);
+	for (i=0 ; i<2 ; i++) {
+	    if (shapePtr->filterChainPtr[i] != NULL) {
+		size += TclOOChainSize(shapePtr->filterChainPtr[i]);
+	    }
+	}
+    }
+
+    Tcl_InitHashTable(&doneTable, TCL_ONE_WORD_KEYS);
+    stack = (Class **) ckalloc(sizeof(Class *) * stackSize);
+    stack[depth++] = fPtr->objectCls;
+    while (depth > 0) {
+	clsPtr = stack[--depth];
+	Tcl_CreateHashEntry(&doneTable, (char *) clsPtr, &isNew);
+	if (!isNew) {
+	    continue;
+	}
+
+	size += TclOOChainTableSize(clsPtr->classChainCache);
+	size += TclOOChainTableSize(clsPtr->unfilteredChainCache);
+	if (clsPtr->constructorChainPtr != NULL) {
+	    size += TclOOChainSize(clsPtr->constructorChainPtr);
+	}
+	if (clsPtr->destructorChainPtr != NULL) {
+	    size += TclOOChainSize(clsPtr->destructorChainPtr);
+	}
+	for (i=0 ; i<2 ; i++) {
+	    if (clsPtr->filterChainPtr[i] != NULL) {
+		size += TclOOChainSize(clsPtr->filterChainPtr[i]);
+	    }
+	}
+	FOREACH(instancePtr, clsPtr->instances) {
+	    if (instancePtr != NULL && instancePtr->selfCls == clsPtr) {
+		size += TclOOChainTableSize(instancePtr->chainCache);
+		size += TclOOChainTableSize(instancePtr->unfilteredChainCache);
+		if (instancePtr->filterChainPtr[0] != NULL) {
+		    size += TclOOChainSize(instancePtr->filterChainPtr[0]);
+		}
+		if (instancePtr->filterChainPtr[1] != NULL) {
+		    size += TclOOChainSize(instancePtr->filterChainPtr[1]);
+		}
+	    }
+	}
+
+	if (depth + clsPtr->subclasses.num > stackSize) {
+	    stackSize = 2 * (depth + clsPtr->subclasses.num);
+	    stack = (Class **) ckrealloc((char *) stack,
+		    sizeof(Class *) * stackSize);
+	}
+	FOREACH(subPtr, clsPtr->subclasses) {
+	    if (subPtr != NULL) {
+		stack[depth++] = subPtr;
+	    }
+	}
+    }
+    ckfree((char *) stack);
+    Tcl_DeleteHashTable(&doneTable);
+    return size;
 }
-
+
+Tcl_WideInt
+TclOOChainTableSize(
+    Tcl_HashTable *tablePtr)
+{
+    FOREACH_HASH_DECLS;
+    CallChain *callPtr;
+    Tcl_WideInt size;
+
+    if (tablePtr == NULL) {
+	return 0;
+    }
+    size = sizeof(Tcl_HashTable)
+	    + sizeof(Tcl_HashEntry *) * tablePtr->numBuckets
+	    + sizeof(Tcl_HashEntry) * tablePtr->numEntries;
+    FOREACH_HASH_VALUE(callPtr, tablePtr) {
+	if (callPtr != NULL) {
+	    size += TclOOChainSize(callPtr);
+	}
+    }
+    return size;
+}
+
+Tcl_WideInt
+TclOOChainSize(
+    CallChain *callPtr)
+{
+    Tcl_WideInt size = sizeof(CallChain);
+
+    if (callPtr->chain != callPtr->staticChain) {
+	size += sizeof(struct MInvoke) * callPtr->numChain;
+    }
+    return size;
+}
+
 /*
  * Local Variables:
  * mode: c
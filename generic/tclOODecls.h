@@ -100,6 +100,23 @@ EXTERN void		Tcl_ClassSetDestructor(Tcl_Interp *interp,
 /* 28 */
 EXTERN Tcl_Obj *	Tcl_GetObjectName(Tcl_Interp *interp,
 				Tcl_Object object);
+/* 29 */
+EXTERN int		Tcl_ClassIsSubclass(Tcl_Class clazz,
+				Tcl_Class superclass);
+/* 30 */
+EXTERN Tcl_ObjectMapMethodNameProc2 * Tcl_ObjectGetMethodNameMapper2(Tcl_Object object);
+/* 31 */
+EXTERN void		Tcl_ObjectSetMethodNameMapper2(Tcl_Object object,
+				Tcl_ObjectMapMethodNameProc2 *mapMethodNameProc);
+/* 32 */
+EXTERN Tcl_ObjectWeakRef Tcl_ObjectGetWeakRef(Tcl_Object object);
+/* 33 */
+EXTERN Tcl_Object	Tcl_ObjectFromWeakRef(Tcl_Interp *interp,
+				Tcl_ObjectWeakRef ref);
+/* 34 */
+EXTERN int		Tcl_ClassForeachInstance(Tcl_Class clazz, int flags,
+				Tcl_ClassInstanceProc *proc,
+				ClientData clientData);
 
 typedef struct {
     const struct TclOOIntStubs *tclOOIntStubs;
@@ -138,6 +155,12 @@ typedef struct TclOOStubs {
     void (*tcl_ClassSetConstructor) (Tcl_Interp *interp, Tcl_Class clazz, Tcl_Method method); /* 26 */
     void (*tcl_ClassSetDestructor) (Tcl_Interp *interp, Tcl_Class clazz, Tcl_Method method); /* 27 */
     Tcl_Obj * (*tcl_GetObjectName) (Tcl_Interp *interp, Tcl_Object object); /* 28 */
+    int (*tcl_ClassIsSubclass) (Tcl_Class clazz, Tcl_Class superclass); /* 29 */
+    Tcl_ObjectMapMethodNameProc2 * (*tcl_ObjectGetMethodNameMapper2) (Tcl_Object object); /* 30 */
+    void (*tcl_ObjectSetMethodNameMapper2) (Tcl_Object object, Tcl_ObjectMapMethodNameProc2 *mapMethodNameProc); /* 31 */
+    Tcl_ObjectWeakRef (*tcl_ObjectGetWeakRef) (Tcl_Object object); /* 32 */
+    Tcl_Object (*tcl_ObjectFromWeakRef) (Tcl_Interp *interp, Tcl_ObjectWeakRef ref); /* 33 */
+    int (*tcl_ClassForeachInstance) (Tcl_Class clazz, int flags, Tcl_ClassInstanceProc *proc, ClientData clientData); /* 34 */
 } TclOOStubs;
 
 extern const TclOOStubs *tclOOStubsPtr;
@@ -210,6 +233,18 @@ extern const TclOOStubs *tclOOStubsPtr;
 	(tclOOStubsPtr->tcl_ClassSetDestructor) /* 27 */
 #define Tcl_GetObjectName \
 	(tclOOStubsPtr->tcl_GetObjectName) /* 28 */
+#define Tcl_ClassIsSubclass \
+	(tclOOStubsPtr->tcl_ClassIsSubclass) /* 29 */
+#define Tcl_ObjectGetMethodNameMapper2 \
+	(tclOOStubsPtr->tcl_ObjectGetMethodNameMapper2) /* 30 */
+#define Tcl_ObjectSetMethodNameMapper2 \
+	(tclOOStubsPtr->tcl_ObjectSetMethodNameMapper2) /* 31 */
+#define Tcl_ObjectGetWeakRef \
+	(tclOOStubsPtr->tcl_ObjectGetWeakRef) /* 32 */
+#define Tcl_ObjectFromWeakRef \
+	(tclOOStubsPtr->tcl_ObjectFromWeakRef) /* 33 */
+#define Tcl_ClassForeachInstance \
+	(tclOOStubsPtr->tcl_ClassForeachInstance) /* 34 */
 
 #endif /* defined(USE_TCLOO_STUBS) */
 
@@ -23,6 +23,13 @@
 
 #define OBJNAME_LENGTH_IN_ERRORINFO_LIMIT 30
 
+/*
+ * The number of object shells that a class keeps for reuse when told to pool
+ * its instances without being told how many to keep.
+ */
+
+#define DEFAULT_POOL_SIZE 32
+
 /*
  * Some things that make it easier to declare a slot.
  */
@@ -44,9 +51,14 @@ struct DeclaredSlot {
  * Forward declarations.
  */
 
-static inline void	BumpGlobalEpoch(Tcl_Interp *interp, Class *classPtr);
+static inline void	BumpGlobalEpoch(Tcl_Interp *interp, Class *classPtr,
+			    int cause);
+static Tcl_Obj *	DefineSubcommandName(Tcl_Interp *interp,
+			    Tcl_Obj *nameObj, Tcl_Namespace *namespacePtr);
+static void		DupDefineCmdRep(Tcl_Obj *srcPtr, Tcl_Obj *dstPtr);
 static Tcl_Command	FindCommand(Tcl_Interp *interp, Tcl_Obj *stringObj,
 			    Tcl_Namespace *const namespacePtr);
+static void		FreeDefineCmdRep(Tcl_Obj *objPtr);
 static void		GenerateErrorInfo(Tcl_Interp *interp, Object *oPtr,
 			    Tcl_Obj *savedNameObj, const char *typeOfSubject);
 static inline Class *	GetClassInOuterContext(Tcl_Interp *interp,
@@ -116,6 +128,29 @@ static const struct DeclaredSlot slots[] = {
     {NULL}
 };
 
+/*
+ * Object type used to remember which definition command a word names when
+ * [oo::define] and friends are used in their multi-argument form, so that
+ * generated code that makes many one-line definitions does not resolve the
+ * command afresh each time.
+ */
+
+typedef struct DefineCmdRep {
+    Command *cmdPtr;		/* The resolved command. Reference counted so
+				 * that it can be checked for deletion. */
+    int cmdEpoch;		/* The command's epoch when it was resolved. */
+    Tcl_Namespace *nsPtr;	/* The namespace the resolution was done in. */
+    Tcl_Obj *fullNameObj;	/* Fully-qualified name of the command. */
+} DefineCmdRep;
+
+static Tcl_ObjType defineCmdType = {
+    "TclOO definition command",
+    FreeDefineCmdRep,
+    DupDefineCmdRep,
+    NULL,
+    NULL
+};
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -132,7 +167,8 @@ static const struct DeclaredSlot slots[] = {
 static inline void
 BumpGlobalEpoch(
     Tcl_Interp *interp,
-    Class *classPtr)
+    Class *classPtr,
+    int cause)
 {
     if (classPtr != NULL
 	    && classPtr->subclasses.num == 0
@@ -147,7 +183,7 @@ BumpGlobalEpoch(
 	 */
 
 	if (classPtr->thisPtr->mixins.num > 0) {
-	    classPtr->thisPtr->epoch++;
+	    TclOOObjectChanged(classPtr->thisPtr);
 	}
 	return;
     }
@@ -157,7 +193,7 @@ BumpGlobalEpoch(
      * in use. Force regeneration of call chains.
      */
 
-    TclOOGetFoundation(interp)->epoch++;
+    TclOOBumpEpoch(TclOOGetFoundation(interp), cause);
 }
 
 /*
@@ -238,7 +274,7 @@ TclOOObjectSetFilters(
 	oPtr->filters.num = numFilters;
 	oPtr->flags &= ~USE_CLASS_CACHE;
     }
-    oPtr->epoch++;		/* Only this object can be affected. */
+    TclOOObjectChanged(oPtr);	/* Only this object can be affected. */
 }
 
 /*
@@ -301,7 +337,7 @@ TclOOClassSetFilters(
      * There may be many objects affected, so bump the global epoch.
      */
 
-    BumpGlobalEpoch(interp, classPtr);
+    BumpGlobalEpoch(interp, classPtr, EPOCH_FILTER);
 }
 
 /*
@@ -356,7 +392,7 @@ TclOOObjectSetMixins(
 	    }
 	}
     }
-    oPtr->epoch++;
+    TclOOObjectChanged(oPtr);
 }
 
 /*
@@ -404,7 +440,8 @@ TclOOClassSetMixins(
 	    TclOOAddToMixinSubs(classPtr, mixinPtr);
 	}
     }
-    BumpGlobalEpoch(interp, classPtr);
+    classPtr->thisPtr->fPtr->ancestryEpoch++;
+    BumpGlobalEpoch(interp, classPtr, EPOCH_MIXIN);
 }
 
 /*
@@ -625,6 +662,109 @@ FindCommand(
     return cmd;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DupDefineCmdRep, FreeDefineCmdRep --
+ *	Functions to implement the required parts of the Tcl_Obj guts needed
+ *	for caching of definition command lookups in Tcl_Objs.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+DupDefineCmdRep(
+    Tcl_Obj *srcPtr,
+    Tcl_Obj *dstPtr)
+{
+    DefineCmdRep *repPtr = srcPtr->internalRep.otherValuePtr;
+    DefineCmdRep *rep2Ptr = (DefineCmdRep *) ckalloc(sizeof(DefineCmdRep));
+
+    *rep2Ptr = *repPtr;
+    rep2Ptr->cmdPtr->refCount++;
+    Tcl_IncrRefCount(rep2Ptr->fullNameObj);
+    dstPtr->typePtr = &defineCmdType;
+    dstPtr->internalRep.otherValuePtr = rep2Ptr;
+}
+
+static void
+FreeDefineCmdRep(
+    Tcl_Obj *objPtr)
+{
+    DefineCmdRep *repPtr = objPtr->internalRep.otherValuePtr;
+
+    TclCleanupCommand(repPtr->cmdPtr);
+    Tcl_DecrRefCount(repPtr->fullNameObj);
+    ckfree((char *) repPtr);
+    objPtr->typePtr = NULL;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DefineSubcommandName --
+ *	Get the fully-qualified name of the definition command that a word
+ *	refers to, for use as the first word of the command when the
+ *	multi-argument forms of [oo::define] and [oo::objdefine] dispatch.
+ *	Exact matches are remembered in the word's internal representation.
+ *	The result has had its reference count incremented.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static Tcl_Obj *
+DefineSubcommandName(
+    Tcl_Interp *interp,
+    Tcl_Obj *nameObj,
+    Tcl_Namespace *namespacePtr)
+{
+    DefineCmdRep *repPtr;
+    Command *cmdPtr;
+    Tcl_Obj *fullNameObj;
+
+    if (nameObj->typePtr == &defineCmdType) {
+	repPtr = nameObj->internalRep.otherValuePtr;
+	if (repPtr->nsPtr == namespacePtr
+		&& !(repPtr->cmdPtr->flags & CMD_IS_DELETED)
+		&& repPtr->cmdPtr->cmdEpoch == repPtr->cmdEpoch) {
+	    Tcl_IncrRefCount(repPtr->fullNameObj);
+	    return repPtr->fullNameObj;
+	}
+    }
+
+    fullNameObj = Tcl_NewObj();
+    Tcl_IncrRefCount(fullNameObj);
+    cmdPtr = (Command *) FindCommand(interp, nameObj, namespacePtr);
+    if (cmdPtr == NULL) {
+	/* punt this case! */
+	Tcl_AppendObjToObj(fullNameObj, nameObj);
+	return fullNameObj;
+    }
+    Tcl_GetCommandFullName(interp, (Tcl_Command) cmdPtr, fullNameObj);
+
+    /*
+     * Only remember exact matches; a unique prefix can become ambiguous when
+     * further commands are created, and that is not tracked by the command's
+     * epoch.
+     */
+
+    if (strcmp(Tcl_GetCommandName(interp, (Tcl_Command) cmdPtr),
+	    TclGetString(nameObj)) != 0) {
+	return fullNameObj;
+    }
+    repPtr = (DefineCmdRep *) ckalloc(sizeof(DefineCmdRep));
+    repPtr->cmdPtr = cmdPtr;
+    repPtr->cmdEpoch = cmdPtr->cmdEpoch;
+    repPtr->nsPtr = namespacePtr;
+    repPtr->fullNameObj = fullNameObj;
+    cmdPtr->refCount++;
+    Tcl_IncrRefCount(fullNameObj);
+    TclFreeIntRep(nameObj);
+    nameObj->typePtr = &defineCmdType;
+    nameObj->internalRep.otherValuePtr = repPtr;
+    return fullNameObj;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -840,10 +980,8 @@ TclOODefineObjCmd(
 	}
 	Tcl_DecrRefCount(objNameObj);
     } else {
-	Tcl_Obj *objPtr, *obj2Ptr, **objs;
+	Tcl_Obj **objs;
 	Interp *iPtr = (Interp *) interp;
-	Tcl_Command cmd;
-	int dummy;
 
 	/*
 	 * More than one argument: fire them through the ensemble processing
@@ -869,25 +1007,18 @@ TclOODefineObjCmd(
 	}
 
 	/*
-	 * Build the list of arguments using a Tcl_Obj as a workspace. See
-	 * comments above for why these contortions are necessary.
+	 * Build the argument vector on the stack, with the definition command
+	 * replaced by its fully-qualified name. See comments above for why
+	 * these contortions are necessary.
 	 */
 
-	objPtr = Tcl_NewObj();
-	obj2Ptr = Tcl_NewObj();
-	cmd = FindCommand(interp, objv[2], fPtr->defineNs);
-	if (cmd == NULL) {
-	    /* punt this case! */
-	    Tcl_AppendObjToObj(obj2Ptr, objv[2]);
-	} else {
-	    Tcl_GetCommandFullName(interp, cmd, obj2Ptr);
-	}
-	Tcl_ListObjAppendElement(NULL, objPtr, obj2Ptr);
-	Tcl_ListObjReplace(NULL, objPtr, 1, 0, objc-3, objv+3);
-	Tcl_ListObjGetElements(NULL, objPtr, &dummy, &objs);
+	objs = TclStackAlloc(interp, sizeof(Tcl_Obj *) * (objc-2));
+	objs[0] = DefineSubcommandName(interp, objv[2], fPtr->defineNs);
+	memcpy(objs+1, objv+3, sizeof(Tcl_Obj *) * (objc-3));
 
 	result = Tcl_EvalObjv(interp, objc-2, objs, TCL_EVAL_INVOKE);
-	Tcl_DecrRefCount(objPtr);
+	Tcl_DecrRefCount(objs[0]);
+	TclStackFree(interp, objs);
     }
     DelRef(oPtr);
 
@@ -954,10 +1085,8 @@ TclOOObjDefObjCmd(
 	}
 	Tcl_DecrRefCount(objNameObj);
     } else {
-	Tcl_Obj *objPtr, *obj2Ptr, **objs;
+	Tcl_Obj **objs;
 	Interp *iPtr = (Interp *) interp;
-	Tcl_Command cmd;
-	int dummy;
 
 	/*
 	 * More than one argument: fire them through the ensemble processing
@@ -983,25 +1112,18 @@ TclOOObjDefObjCmd(
 	}
 
 	/*
-	 * Build the list of arguments using a Tcl_Obj as a workspace. See
-	 * comments above for why these contortions are necessary.
+	 * Build the argument vector on the stack, with the definition command
+	 * replaced by its fully-qualified name. See comments above for why
+	 * these contortions are necessary.
 	 */
 
-	objPtr = Tcl_NewObj();
-	obj2Ptr = Tcl_NewObj();
-	cmd = FindCommand(interp, objv[2], fPtr->objdefNs);
-	if (cmd == NULL) {
-	    /* punt this case! */
-	    Tcl_AppendObjToObj(obj2Ptr, objv[2]);
-	} else {
-	    Tcl_GetCommandFullName(interp, cmd, obj2Ptr);
-	}
-	Tcl_ListObjAppendElement(NULL, objPtr, obj2Ptr);
-	Tcl_ListObjReplace(NULL, objPtr, 1, 0, objc-3, objv+3);
-	Tcl_ListObjGetElements(NULL, objPtr, &dummy, &objs);
+	objs = TclStackAlloc(interp, sizeof(Tcl_Obj *) * (objc-2));
+	objs[0] = DefineSubcommandName(interp, objv[2], fPtr->objdefNs);
+	memcpy(objs+1, objv+3, sizeof(Tcl_Obj *) * (objc-3));
 
 	result = Tcl_EvalObjv(interp, objc-2, objs, TCL_EVAL_INVOKE);
-	Tcl_DecrRefCount(objPtr);
+	Tcl_DecrRefCount(objs[0]);
+	TclStackFree(interp, objs);
     }
     DelRef(oPtr);
 
@@ -1068,10 +1190,8 @@ TclOODefineSelfObjCmd(
 	}
 	Tcl_DecrRefCount(objNameObj);
     } else {
-	Tcl_Obj *objPtr, *obj2Ptr, **objs;
+	Tcl_Obj **objs;
 	Interp *iPtr = (Interp *) interp;
-	Tcl_Command cmd;
-	int dummy;
 
 	/*
 	 * More than one argument: fire them through the ensemble processing
@@ -1097,25 +1217,18 @@ TclOODefineSelfObjCmd(
 	}
 
 	/*
-	 * Build the list of arguments using a Tcl_Obj as a workspace. See
-	 * comments above for why these contortions are necessary.
+	 * Build the argument vector on the stack, with the definition command
+	 * replaced by its fully-qualified name. See comments above for why
+	 * these contortions are necessary.
 	 */
 
-	objPtr = Tcl_NewObj();
-	obj2Ptr = Tcl_NewObj();
-	cmd = FindCommand(interp, objv[1], fPtr->objdefNs);
-	if (cmd == NULL) {
-	    /* punt this case! */
-	    Tcl_AppendObjToObj(obj2Ptr, objv[1]);
-	} else {
-	    Tcl_GetCommandFullName(interp, cmd, obj2Ptr);
-	}
-	Tcl_ListObjAppendElement(NULL, objPtr, obj2Ptr);
-	Tcl_ListObjReplace(NULL, objPtr, 1, 0, objc-2, objv+2);
-	Tcl_ListObjGetElements(NULL, objPtr, &dummy, &objs);
+	objs = TclStackAlloc(interp, sizeof(Tcl_Obj *) * (objc-1));
+	objs[0] = DefineSubcommandName(interp, objv[1], fPtr->objdefNs);
+	memcpy(objs+1, objv+2, sizeof(Tcl_Obj *) * (objc-2));
 
 	result = Tcl_EvalObjv(interp, objc-1, objs, TCL_EVAL_INVOKE);
-	Tcl_DecrRefCount(objPtr);
+	Tcl_DecrRefCount(objs[0]);
+	TclStackFree(interp, objs);
     }
     DelRef(oPtr);
 
@@ -1206,10 +1319,9 @@ TclOODefineClassObjCmd(
 	    oPtr->flags &= ~CLASS_GONE;
 	}
 	if (oPtr->classPtr != NULL) {
-	    BumpGlobalEpoch(interp, oPtr->classPtr);
-	} else {
-	    oPtr->epoch++;
+	    BumpGlobalEpoch(interp, oPtr->classPtr, EPOCH_CLASS);
 	}
+	TclOOObjectChanged(oPtr);
     }
     return TCL_OK;
 }
@@ -1329,9 +1441,9 @@ TclOODefineDeleteMethodObjCmd(
     }
 
     if (isInstanceDeleteMethod) {
-	oPtr->epoch++;
+	TclOOObjectChanged(oPtr);
     } else {
-	BumpGlobalEpoch(interp, oPtr->classPtr);
+	BumpGlobalEpoch(interp, oPtr->classPtr, EPOCH_METHOD);
     }
     return TCL_OK;
 }
@@ -1485,9 +1597,9 @@ TclOODefineExportObjCmd(
 
     if (changed) {
 	if (isInstanceExport) {
-	    oPtr->epoch++;
+	    TclOOObjectChanged(oPtr);
 	} else {
-	    BumpGlobalEpoch(interp, clsPtr);
+	    BumpGlobalEpoch(interp, clsPtr, EPOCH_EXPORT);
 	}
     }
     return TCL_OK;
@@ -1606,6 +1718,53 @@ TclOODefineMethodObjCmd(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOODefinePoolObjCmd --
+ *	Implementation of the "pool" subcommand of the "oo::define" command.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOODefinePoolObjCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const *objv)
+{
+    Object *oPtr;
+    int size = DEFAULT_POOL_SIZE;
+
+    if (objc > 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "?size?");
+	return TCL_ERROR;
+    }
+
+    oPtr = (Object *) TclOOGetDefineCmdContext(interp);
+    if (oPtr == NULL) {
+	return TCL_ERROR;
+    }
+    if (!oPtr->classPtr) {
+	Tcl_AppendResult(interp, "attempt to misuse API", NULL);
+	return TCL_ERROR;
+    }
+    if (objc == 2) {
+	if (Tcl_GetIntFromObj(interp, objv[1], &size) != TCL_OK) {
+	    return TCL_ERROR;
+	}
+	if (size < 0) {
+	    Tcl_AppendResult(interp, "bad pool size \"", TclGetString(objv[1]),
+		    "\": must be a non-negative integer", NULL);
+	    return TCL_ERROR;
+	}
+    }
+
+    TclOOSetPoolSize(oPtr->classPtr, size);
+    return TCL_OK;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1653,9 +1812,9 @@ TclOODefineRenameMethodObjCmd(
     }
 
     if (isInstanceRenameMethod) {
-	oPtr->epoch++;
+	TclOOObjectChanged(oPtr);
     } else {
-	BumpGlobalEpoch(interp, oPtr->classPtr);
+	BumpGlobalEpoch(interp, oPtr->classPtr, EPOCH_METHOD);
     }
     return TCL_OK;
 }
@@ -1745,9 +1904,9 @@ TclOODefineUnexportObjCmd(
 
     if (changed) {
 	if (isInstanceUnexport) {
-	    oPtr->epoch++;
+	    TclOOObjectChanged(oPtr);
 	} else {
-	    BumpGlobalEpoch(interp, clsPtr);
+	    BumpGlobalEpoch(interp, clsPtr, EPOCH_EXPORT);
 	}
     }
     return TCL_OK;
@@ -1774,7 +1933,7 @@ Tcl_ClassSetConstructor(
 	    TclOODeleteChain(clsPtr->constructorChainPtr);
 	    clsPtr->constructorChainPtr = NULL;
 	}
-	BumpGlobalEpoch(interp, clsPtr);
+	BumpGlobalEpoch(interp, clsPtr, EPOCH_CONSTRUCTOR);
     }
 }
 
@@ -1793,7 +1952,7 @@ Tcl_ClassSetDestructor(
 	    TclOODeleteChain(clsPtr->destructorChainPtr);
 	    clsPtr->destructorChainPtr = NULL;
 	}
-	BumpGlobalEpoch(interp, clsPtr);
+	BumpGlobalEpoch(interp, clsPtr, EPOCH_DESTRUCTOR);
     }
 }
 
@@ -2112,7 +2271,8 @@ ClassSuperSet(
     FOREACH(superPtr, oPtr->classPtr->superclasses) {
 	TclOOAddToSubclasses(oPtr->classPtr, superPtr);
     }
-    BumpGlobalEpoch(interp, oPtr->classPtr);
+    oPtr->fPtr->ancestryEpoch++;
+    BumpGlobalEpoch(interp, oPtr->classPtr, EPOCH_SUPERCLASS);
 
     return TCL_OK;
 
@@ -16,7 +16,23 @@
 #include "tclInt.h"
 #include "tclOOInt.h"
 
+static void		BuildInstanceIndex(Class *clsPtr);
+static int		CompareInstanceNames(const void *ptr1,
+			    const void *ptr2);
+static int		CompareName(Object *oPtr, const char *name);
+static int		ComparePrefix(Object *oPtr, const char *prefix,
+			    int prefixLen);
+static void		FindPrefixRange(Class *clsPtr, const char *prefix,
+			    int *startPtr, int *endPtr);
 static inline Class *  GetClassFromObj(Tcl_Interp *interp, Tcl_Obj *objPtr);
+static inline void	InstanceNameParts(Object *oPtr, const char *parts[3]);
+static int		MatchInstance(ClientData clientData,
+			    Tcl_Object object);
+static void		NamespaceFootprint(Tcl_Namespace *nsPtr,
+			    TclOOFootprint *fpPtr);
+static void		ObjectFootprint(Object *oPtr, TclOOFootprint *fpPtr);
+static Tcl_WideInt	ValueSize(Tcl_Obj *objPtr);
+static Tcl_WideInt	VarTableSize(TclVarHashTable *tablePtr);
 static Tcl_ObjCmdProc InfoObjectCallCmd;
 static Tcl_ObjCmdProc InfoObjectClassCmd;
 static Tcl_ObjCmdProc InfoObjectDefnCmd;
@@ -34,6 +50,7 @@ static Tcl_ObjCmdProc InfoClassConstrCmd;
 static Tcl_ObjCmdProc InfoClassDefnCmd;
 static Tcl_ObjCmdProc InfoClassDestrCmd;
 static Tcl_ObjCmdProc InfoClassFiltersCmd;
+static Tcl_ObjCmdProc InfoClassFootprintCmd;
 static Tcl_ObjCmdProc InfoClassForwardCmd;
 static Tcl_ObjCmdProc InfoClassInstancesCmd;
 static Tcl_ObjCmdProc InfoClassMethodsCmd;
@@ -45,6 +62,28 @@ static Tcl_ObjCmdProc InfoClassVariablesCmd;
 
 struct NameProcMap { const char *name; Tcl_ObjCmdProc *proc; };
 
+/*
+ * What [info class instances -all] is looking for, and what it has found.
+ */
+
+typedef struct {
+    Tcl_Interp *interp;
+    const char *prefix;		/* Prefix to look for, or NULL. */
+    int prefixLen;
+    const char *pattern;	/* Pattern to match, or NULL. */
+    Tcl_DString buffer;		/* Where names are assembled for matching. */
+    Tcl_Obj *resultObj;		/* List of names found, or NULL if we are
+				 * only counting. */
+    int count;			/* Number of instances found. */
+} InstanceQuery;
+
+/*
+ * Helper macro (derived from things private to tclVar.c)
+ */
+
+#define VarHashGetValue(hPtr) \
+    ((Var *) ((char *)hPtr - TclOffset(VarInHash, entry)))
+
 /*
  * List of commands that are used to implement the [info object] subcommands.
  */
@@ -75,6 +114,7 @@ static const struct NameProcMap infoClassCmds[] = {
     {"::oo::InfoClass::definition",   InfoClassDefnCmd},
     {"::oo::InfoClass::destructor",   InfoClassDestrCmd},
     {"::oo::InfoClass::filters",      InfoClassFiltersCmd},
+    {"::oo::InfoClass::footprint",    InfoClassFootprintCmd},
     {"::oo::InfoClass::forward",      InfoClassForwardCmd},
     {"::oo::InfoClass::instances",    InfoClassInstancesCmd},
     {"::oo::InfoClass::methods",      InfoClassMethodsCmd},
@@ -658,7 +698,8 @@ InfoObjectMethodTypeCmd(
 	goto unknownMethod;
     }
 
-    Tcl_SetObjResult(interp, Tcl_NewStringObj(mPtr->typePtr->name, -1));
+    Tcl_SetObjResult(interp,
+	    Tcl_NewStringObj(TclOOMethodTypeName(mPtr), -1));
     return TCL_OK;
 }
 
@@ -1091,12 +1132,346 @@ InfoClassForwardCmd(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * InstanceNameParts --
+ *
+ *	Describes the fully-qualified name of an object as three strings that
+ *	concatenate to give it, without allocating anything. The object must
+ *	still have its command.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static inline void
+InstanceNameParts(
+    Object *oPtr,
+    const char *parts[3])
+{
+    Command *cmdPtr = (Command *) oPtr->command;
+    Namespace *nsPtr = cmdPtr->nsPtr;
+
+    if (nsPtr->parentPtr == NULL) {
+	parts[0] = "";
+    } else {
+	parts[0] = nsPtr->fullName;
+    }
+    parts[1] = "::";
+    parts[2] = Tcl_GetHashKey(cmdPtr->hPtr->tablePtr, cmdPtr->hPtr);
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * CompareInstanceNames, CompareName, ComparePrefix --
+ *
+ *	Orderings on object names used to sort and search the index of a
+ *	class's instances. Names are compared byte by byte, which is all the
+ *	index needs as prefixes and patterns are always looked for in it in
+ *	the same way.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+CompareInstanceNames(
+    const void *ptr1,
+    const void *ptr2)
+{
+    const char *a[3], *b[3], *p, *q;
+    int i = 0, j = 0;
+
+    InstanceNameParts(*(Object **) ptr1, a);
+    InstanceNameParts(*(Object **) ptr2, b);
+    p = a[0];
+    q = b[0];
+    while (1) {
+	while (*p == '\0' && i < 2) {
+	    p = a[++i];
+	}
+	while (*q == '\0' && j < 2) {
+	    q = b[++j];
+	}
+	if (*p != *q) {
+	    return UCHAR(*p) - UCHAR(*q);
+	}
+	if (*p == '\0') {
+	    return 0;
+	}
+	p++;
+	q++;
+    }
+}
+
+static int
+CompareName(
+    Object *oPtr,		/* The object whose name is compared. */
+    const char *name)		/* The fully-qualified name to compare it
+				 * with. */
+{
+    const char *parts[3], *p;
+    int i = 0;
+
+    InstanceNameParts(oPtr, parts);
+    p = parts[0];
+    while (1) {
+	while (*p == '\0' && i < 2) {
+	    p = parts[++i];
+	}
+	if (*p != *name) {
+	    return UCHAR(*p) - UCHAR(*name);
+	}
+	if (*p == '\0') {
+	    return 0;
+	}
+	p++;
+	name++;
+    }
+}
+
+static int
+ComparePrefix(
+    Object *oPtr,		/* The object whose name is compared. */
+    const char *prefix,		/* The prefix to compare it with. */
+    int prefixLen)		/* The length of the prefix, in bytes. */
+{
+    const char *parts[3], *p;
+    int i = 0, n;
+
+    InstanceNameParts(oPtr, parts);
+    p = parts[0];
+    for (n=0 ; n<prefixLen ; n++,p++) {
+	while (*p == '\0' && i < 2) {
+	    p = parts[++i];
+	}
+	if (*p != prefix[n]) {
+	    return UCHAR(*p) - UCHAR(prefix[n]);
+	}
+    }
+    return 0;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * BuildInstanceIndex --
+ *
+ *	Works out the index of a class's instances, sorted by name. The index
+ *	is made when it is first searched, and is then kept up to date as the
+ *	instances are added, removed and renamed (see TclOOIndexInstance and
+ *	TclOOUnindexInstance). It has as much space as the list of instances.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+BuildInstanceIndex(
+    Class *clsPtr)
+{
+    Object *oPtr;
+    int i, n = 0;
+
+    clsPtr->instanceIndex = (Object **) ckalloc(sizeof(Object *)
+	    * (clsPtr->instances.size > 0 ? clsPtr->instances.size : 1));
+    FOREACH(oPtr, clsPtr->instances) {
+	if (oPtr != NULL && oPtr->command != NULL) {
+	    clsPtr->instanceIndex[n++] = oPtr;
+	}
+    }
+    qsort(clsPtr->instanceIndex, (unsigned) n, sizeof(Object *),
+	    CompareInstanceNames);
+    clsPtr->numIndexed = n;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOIndexInstance, TclOOUnindexInstance --
+ *
+ *	Keep the index of a class's instances (if it has been made) up to
+ *	date, by binary search. An object is only in the index while it has
+ *	its command. TclOOIndexInstance must be called after the object has
+ *	been added to the class's list of instances, so that the index has
+ *	room for it. TclOOUnindexInstance finds the object by the given name
+ *	if it is not NULL (as when the object has just been renamed, when the
+ *	object's entry is out of order until it is taken out), and by its
+ *	current name otherwise.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+void
+TclOOIndexInstance(
+    Class *clsPtr,		/* The class whose index is to be updated. */
+    Object *oPtr)		/* The instance to put in the index. */
+{
+    Object **indexPtr = clsPtr->instanceIndex;
+    int lo = 0, hi = clsPtr->numIndexed, mid;
+
+    if (indexPtr == NULL || oPtr->command == NULL) {
+	return;
+    }
+    if (clsPtr->numIndexed >= clsPtr->instances.size) {
+	/*
+	 * Should not happen, but if the index is out of step with the list of
+	 * instances, make it again from the list when it is next needed.
+	 */
+
+	TclOOForgetInstanceIndex(clsPtr);
+	return;
+    }
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (CompareInstanceNames(&indexPtr[mid], &oPtr) < 0) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    memmove(&indexPtr[lo + 1], &indexPtr[lo],
+	    sizeof(Object *) * (clsPtr->numIndexed - lo));
+    indexPtr[lo] = oPtr;
+    clsPtr->numIndexed++;
+}
+
+void
+TclOOUnindexInstance(
+    Class *clsPtr,		/* The class whose index is to be updated. */
+    Object *oPtr,		/* The instance to take out of the index. */
+    const char *name)		/* The fully-qualified name that the object
+				 * is indexed under, or NULL if that is its
+				 * current name. */
+{
+    Object **indexPtr = clsPtr->instanceIndex;
+    int lo = 0, hi = clsPtr->numIndexed - 1, mid, cmp;
+
+    if (indexPtr == NULL || (name == NULL && oPtr->command == NULL)) {
+	return;
+    }
+    while (lo <= hi) {
+	mid = (lo + hi) / 2;
+	if (indexPtr[mid] == oPtr) {
+	    clsPtr->numIndexed--;
+	    memmove(&indexPtr[mid], &indexPtr[mid + 1],
+		    sizeof(Object *) * (clsPtr->numIndexed - mid));
+	    return;
+	}
+	if (name != NULL) {
+	    cmp = CompareName(indexPtr[mid], name);
+	} else {
+	    cmp = CompareInstanceNames(&indexPtr[mid], &oPtr);
+	}
+	if (cmp < 0) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid - 1;
+	}
+    }
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * FindPrefixRange --
+ *
+ *	Finds the range of entries in the index of a class's instances whose
+ *	names start with the given prefix, by binary search. On return, the
+ *	entries from *startPtr up to but not including *endPtr are the ones
+ *	that match.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+FindPrefixRange(
+    Class *clsPtr,
+    const char *prefix,
+    int *startPtr,
+    int *endPtr)
+{
+    int prefixLen = strlen(prefix);
+    int lo = 0, hi = clsPtr->numIndexed, mid;
+
+    if (clsPtr->instanceIndex == NULL) {
+	BuildInstanceIndex(clsPtr);
+	hi = clsPtr->numIndexed;
+    }
+
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (ComparePrefix(clsPtr->instanceIndex[mid], prefix, prefixLen) < 0) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    *startPtr = lo;
+
+    hi = clsPtr->numIndexed;
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (ComparePrefix(clsPtr->instanceIndex[mid], prefix, prefixLen) > 0) {
+	    hi = mid;
+	} else {
+	    lo = mid + 1;
+	}
+    }
+    *endPtr = lo;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * MatchInstance --
+ *
+ *	Callback used with Tcl_ClassForeachInstance to find the instances of a
+ *	class and the classes below it that match a query.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+MatchInstance(
+    ClientData clientData,
+    Tcl_Object object)
+{
+    InstanceQuery *queryPtr = clientData;
+    Object *oPtr = (Object *) object;
+
+    if (queryPtr->prefix != NULL
+	    && ComparePrefix(oPtr, queryPtr->prefix, queryPtr->prefixLen)) {
+	return TCL_OK;
+    }
+    if (queryPtr->pattern != NULL) {
+	const char *parts[3];
+
+	InstanceNameParts(oPtr, parts);
+	Tcl_DStringSetLength(&queryPtr->buffer, 0);
+	Tcl_DStringAppend(&queryPtr->buffer, parts[0], -1);
+	Tcl_DStringAppend(&queryPtr->buffer, parts[1], -1);
+	Tcl_DStringAppend(&queryPtr->buffer, parts[2], -1);
+	if (!Tcl_StringMatch(Tcl_DStringValue(&queryPtr->buffer),
+		queryPtr->pattern)) {
+	    return TCL_OK;
+	}
+    }
+    if (queryPtr->resultObj != NULL) {
+	Tcl_ListObjAppendElement(NULL, queryPtr->resultObj,
+		TclOOObjectName(queryPtr->interp, oPtr));
+    } else {
+	queryPtr->count++;
+    }
+    return TCL_OK;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
  * InfoClassInstancesCmd --
  *
- *	Implements [info class instances $clsName ?$pattern?]
+ *	Implements [info class instances $clsName ?-all? ?-count?
+ *	?-prefix $str? ?--? ?$pattern?]
  *
  * ----------------------------------------------------------------------
  */
@@ -1110,35 +1485,169 @@ InfoClassInstancesCmd(
 {
     Object *oPtr;
     Class *clsPtr;
-    int i;
-    const char *pattern = NULL;
+    int i, idx, start, end, count = 0, countOnly = 0, recurse = 0;
+    const char *pattern = NULL, *prefix = NULL;
     Tcl_Obj *resultObj;
+    Tcl_DString buffer;
+    static const char *options[] = {
+	"-all", "-count", "-prefix", NULL
+    };
+    enum Options {
+	OPT_ALL, OPT_COUNT, OPT_PREFIX
+    };
 
-    if (objc != 2 && objc != 3) {
-	Tcl_WrongNumArgs(interp, 1, objv, "className ?pattern?");
-	return TCL_ERROR;
+    if (objc < 2) {
+	goto wrongArgs;
     }
     clsPtr = GetClassFromObj(interp, objv[1]);
     if (clsPtr == NULL) {
 	return TCL_ERROR;
     }
-    if (objc == 3) {
-	pattern = TclGetString(objv[2]);
+    for (i=2 ; i<objc ; i++) {
+	/*
+	 * Only the exact option names are options, so that (as before the
+	 * options were added) a pattern may start with a "-". A pattern that
+	 * is one of the option names can be given after "--".
+	 */
+
+	if (!strcmp(TclGetString(objv[i]), "--")) {
+	    i++;
+	    break;
+	}
+	if (Tcl_GetIndexFromObj(NULL, objv[i], options, "option", TCL_EXACT,
+		&idx) != TCL_OK) {
+	    break;
+	}
+	switch ((enum Options) idx) {
+	case OPT_ALL:
+	    recurse = 1;
+	    break;
+	case OPT_COUNT:
+	    countOnly = 1;
+	    break;
+	case OPT_PREFIX:
+	    if (++i >= objc) {
+		goto wrongArgs;
+	    }
+	    prefix = TclGetString(objv[i]);
+	    break;
+	}
+    }
+    if (i == objc - 1) {
+	pattern = TclGetString(objv[i]);
+    } else if (i < objc) {
+	goto wrongArgs;
     }
 
-    resultObj = Tcl_NewObj();
-    FOREACH(oPtr, clsPtr->instances) {
-	Tcl_Obj *tmpObj = TclOOObjectName(interp, oPtr);
+    /*
+     * The instances of the classes below this one are found by walking the
+     * class tree, matching each one against the query as we go.
+     */
 
-	if (pattern && !Tcl_StringMatch(TclGetString(tmpObj), pattern)) {
-	    continue;
+    if (recurse) {
+	InstanceQuery query;
+
+	query.interp = interp;
+	query.prefix = prefix;
+	query.prefixLen = (prefix != NULL ? strlen(prefix) : 0);
+	query.pattern = pattern;
+	Tcl_DStringInit(&query.buffer);
+	query.resultObj = (countOnly ? NULL : Tcl_NewObj());
+	query.count = 0;
+	Tcl_ClassForeachInstance((Tcl_Class) clsPtr, TCL_OO_INSTANCES_ALL,
+		MatchInstance, &query);
+	Tcl_DStringFree(&query.buffer);
+	if (countOnly) {
+	    Tcl_SetObjResult(interp, Tcl_NewIntObj(query.count));
+	} else {
+	    Tcl_SetObjResult(interp, query.resultObj);
 	}
-	Tcl_ListObjAppendElement(NULL, resultObj, tmpObj);
+	return TCL_OK;
+    }
+
+    /*
+     * Without a prefix or pattern, there's no searching to do; the list of
+     * instances is reported in the order that it is held.
+     */
+
+    if (prefix == NULL && pattern == NULL) {
+	if (countOnly) {
+	    FOREACH(oPtr, clsPtr->instances) {
+		if (oPtr != NULL && oPtr->command != NULL) {
+		    count++;
+		}
+	    }
+	    Tcl_SetObjResult(interp, Tcl_NewIntObj(count));
+	    return TCL_OK;
+	}
+	resultObj = Tcl_NewObj();
+	FOREACH(oPtr, clsPtr->instances) {
+	    Tcl_ListObjAppendElement(NULL, resultObj,
+		    TclOOObjectName(interp, oPtr));
+	}
+	Tcl_SetObjResult(interp, resultObj);
+	return TCL_OK;
+    }
+
+    /*
+     * Otherwise, use the index of the instances' names. The prefix, or
+     * failing that the literal leading part of the pattern, gives us the
+     * range of the index to look at; the pattern is then only matched
+     * against the names in that range, which we assemble in a buffer so as
+     * to not force every instance to cache its name. The instances are
+     * reported in the order of the index, i.e., sorted by name.
+     */
+
+    if (prefix == NULL) {
+	Tcl_DStringInit(&buffer);
+	Tcl_DStringAppend(&buffer, pattern, strcspn(pattern, "*?[\\"));
+	FindPrefixRange(clsPtr, Tcl_DStringValue(&buffer), &start, &end);
+	Tcl_DStringFree(&buffer);
+    } else {
+	FindPrefixRange(clsPtr, prefix, &start, &end);
+    }
+
+    if (pattern == NULL && countOnly) {
+	Tcl_SetObjResult(interp, Tcl_NewIntObj(end - start));
+	return TCL_OK;
+    }
+
+    resultObj = (countOnly ? NULL : Tcl_NewObj());
+    Tcl_DStringInit(&buffer);
+    for (i=start ; i<end ; i++) {
+	oPtr = clsPtr->instanceIndex[i];
+	if (pattern != NULL) {
+	    const char *parts[3];
+
+	    InstanceNameParts(oPtr, parts);
+	    Tcl_DStringSetLength(&buffer, 0);
+	    Tcl_DStringAppend(&buffer, parts[0], -1);
+	    Tcl_DStringAppend(&buffer, parts[1], -1);
+	    Tcl_DStringAppend(&buffer, parts[2], -1);
+	    if (!Tcl_StringMatch(Tcl_DStringValue(&buffer), pattern)) {
+		continue;
+	    }
+	}
+	if (countOnly) {
+	    count++;
+	} else {
+	    Tcl_ListObjAppendElement(NULL, resultObj,
+		    TclOOObjectName(interp, oPtr));
+	}
+    }
+    Tcl_DStringFree(&buffer);
+    if (countOnly) {
+	resultObj = Tcl_NewIntObj(count);
     }
     Tcl_SetObjResult(interp, resultObj);
     return TCL_OK;
+
+  wrongArgs:
+    Tcl_WrongNumArgs(interp, 1, objv,
+	    "className ?-all? ?-count? ?-prefix string? ?--? ?pattern?");
+    return TCL_ERROR;
 }
-
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1268,7 +1777,8 @@ InfoClassMethodTypeCmd(
 
 	goto unknownMethod;
     }
-    Tcl_SetObjResult(interp, Tcl_NewStringObj(mPtr->typePtr->name, -1));
+    Tcl_SetObjResult(interp,
+	    Tcl_NewStringObj(TclOOMethodTypeName(mPtr), -1));
     return TCL_OK;
 }
 
@@ -1533,6 +2043,262 @@ InfoClassCallCmd(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * InfoClassFootprintCmd --
+ *
+ *	Implements [info class footprint $clsName]
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+InfoClassFootprintCmd(
+    ClientData clientData,
+    Tcl_Interp *interp,
+    int objc,
+    Tcl_Obj *const objv[])
+{
+    Class *clsPtr;
+    TclOOFootprint fp;
+    Tcl_Obj *resultObj;
+
+    if (objc != 2) {
+	Tcl_WrongNumArgs(interp, 1, objv, "className");
+	return TCL_ERROR;
+    }
+    clsPtr = GetClassFromObj(interp, objv[1]);
+    if (clsPtr == NULL) {
+	return TCL_ERROR;
+    }
+
+    memset(&fp, 0, sizeof(TclOOFootprint));
+    TclOOGetClassFootprint(clsPtr, &fp);
+
+    resultObj = Tcl_NewObj();
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("instances", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewIntObj(fp.numInstances));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("structure", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(fp.structBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("namespace", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(fp.namespaceBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("vars", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewWideIntObj(fp.varBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("methods", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(fp.methodBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("chains", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(fp.chainBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewStringObj("metadata", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj,
+	    Tcl_NewWideIntObj(fp.metadataBytes));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewStringObj("total", -1));
+    Tcl_ListObjAppendElement(NULL, resultObj, Tcl_NewWideIntObj(
+	    fp.structBytes + fp.namespaceBytes + fp.varBytes + fp.methodBytes
+	    + fp.chainBytes + fp.metadataBytes));
+    Tcl_SetObjResult(interp, resultObj);
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOGetClassFootprint --
+ *
+ *	Computes the approximate amount of memory used by a class and by the
+ *	objects that are direct instances of it (i.e., not the instances of
+ *	its subclasses) by walking the structures concerned, adding the sizes
+ *	to the structure pointed to by fpPtr, which the caller must have
+ *	initialized. Memory shared between several objects (such as a value in
+ *	two variables) is counted once per use.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+void
+TclOOGetClassFootprint(
+    Class *clsPtr,
+    TclOOFootprint *fpPtr)
+{
+    FOREACH_HASH_DECLS;
+    Object *instancePtr;
+    Method *mPtr;
+    int i;
+
+    /*
+     * The class itself.
+     */
+
+    ObjectFootprint(clsPtr->thisPtr, fpPtr);
+    fpPtr->structBytes += sizeof(Class)
+	    + sizeof(Class *) * (clsPtr->superclasses.num
+		    + clsPtr->subclasses.size + clsPtr->mixins.num
+		    + clsPtr->mixinSubs.size)
+	    + sizeof(Object *) * (clsPtr->instances.size
+		    + (clsPtr->pool.list ? clsPtr->poolSize : 0)
+		    + (clsPtr->instanceIndex == NULL ? 0
+			    : clsPtr->instances.size > 0
+			    ? clsPtr->instances.size : 1))
+	    + sizeof(Tcl_Obj *) * (clsPtr->filters.num
+		    + clsPtr->variables.num)
+	    + sizeof(int) * clsPtr->numAncestors;
+    fpPtr->methodBytes += TclOOMethodSize(clsPtr->constructorPtr)
+	    + TclOOMethodSize(clsPtr->destructorPtr)
+	    + sizeof(Tcl_HashEntry) * clsPtr->classMethods.numEntries;
+    FOREACH_HASH_VALUE(mPtr, &clsPtr->classMethods) {
+	fpPtr->methodBytes += TclOOMethodSize(mPtr);
+    }
+    if (clsPtr->classChainCache != NULL) {
+	fpPtr->chainBytes += TclOOChainTableSize(clsPtr->classChainCache);
+    }
+    if (clsPtr->unfilteredChainCache != NULL) {
+	fpPtr->chainBytes +=
+		TclOOChainTableSize(clsPtr->unfilteredChainCache);
+    }
+    if (clsPtr->constructorChainPtr != NULL) {
+	fpPtr->chainBytes += TclOOChainSize(clsPtr->constructorChainPtr);
+    }
+    if (clsPtr->destructorChainPtr != NULL) {
+	fpPtr->chainBytes += TclOOChainSize(clsPtr->destructorChainPtr);
+    }
+    for (i=0 ; i<2 ; i++) {
+	if (clsPtr->filterChainPtr[i] != NULL) {
+	    fpPtr->chainBytes += TclOOChainSize(clsPtr->filterChainPtr[i]);
+	}
+    }
+    if (clsPtr->metadataPtr != NULL) {
+	fpPtr->metadataBytes += sizeof(Tcl_HashTable)
+		+ sizeof(Tcl_HashEntry) * clsPtr->metadataPtr->numEntries;
+    }
+
+    /*
+     * Its direct instances. Objects that merely mix the class in are
+     * accounted to their own class.
+     */
+
+    FOREACH(instancePtr, clsPtr->instances) {
+	if (instancePtr != NULL && instancePtr->selfCls == clsPtr) {
+	    fpPtr->numInstances++;
+	    ObjectFootprint(instancePtr, fpPtr);
+	}
+    }
+
+    /*
+     * The shells of destroyed instances kept for reuse. They are not
+     * instances, but they are still using memory on the class's behalf.
+     */
+
+    FOREACH(instancePtr, clsPtr->pool) {
+	ObjectFootprint(instancePtr, fpPtr);
+    }
+}
+
+static void
+ObjectFootprint(
+    Object *oPtr,
+    TclOOFootprint *fpPtr)
+{
+    FOREACH_HASH_DECLS;
+    Method *mPtr;
+    int i;
+
+    fpPtr->structBytes += sizeof(Object)
+	    + sizeof(Class *) * oPtr->mixins.num
+	    + sizeof(Tcl_Obj *) * (oPtr->filters.num + oPtr->variables.num);
+    if (oPtr->cachedNameObj != NULL) {
+	fpPtr->structBytes += ValueSize(oPtr->cachedNameObj);
+    }
+    if (oPtr->namespacePtr != NULL) {
+	NamespaceFootprint(oPtr->namespacePtr, fpPtr);
+    }
+    if (oPtr->methodsPtr != NULL) {
+	fpPtr->methodBytes += sizeof(Tcl_HashTable)
+		+ sizeof(Tcl_HashEntry) * oPtr->methodsPtr->numEntries;
+	FOREACH_HASH_VALUE(mPtr, oPtr->methodsPtr) {
+	    fpPtr->methodBytes += TclOOMethodSize(mPtr);
+	}
+    }
+    if (oPtr->chainCache != NULL) {
+	fpPtr->chainBytes += TclOOChainTableSize(oPtr->chainCache);
+    }
+    if (oPtr->unfilteredChainCache != NULL) {
+	fpPtr->chainBytes += TclOOChainTableSize(oPtr->unfilteredChainCache);
+    }
+    for (i=0 ; i<2 ; i++) {
+	if (oPtr->filterChainPtr[i] != NULL) {
+	    fpPtr->chainBytes += TclOOChainSize(oPtr->filterChainPtr[i]);
+	}
+    }
+    if (oPtr->mappedNameCache != NULL) {
+	fpPtr->structBytes += sizeof(Tcl_HashTable)
+		+ (sizeof(Tcl_HashEntry) + sizeof(MappedName))
+			* oPtr->mappedNameCache->numEntries;
+    }
+    if (oPtr->metadataPtr != NULL) {
+	fpPtr->metadataBytes += sizeof(Tcl_HashTable)
+		+ sizeof(Tcl_HashEntry) * oPtr->metadataPtr->numEntries;
+    }
+}
+
+static void
+NamespaceFootprint(
+    Tcl_Namespace *nsPtr,
+    TclOOFootprint *fpPtr)
+{
+    Namespace *nPtr = (Namespace *) nsPtr;
+
+    fpPtr->namespaceBytes += sizeof(Namespace)
+	    + strlen(nPtr->name) + strlen(nPtr->fullName) + 2
+	    + sizeof(Tcl_HashEntry *) * nPtr->cmdTable.numBuckets
+	    + (sizeof(Tcl_HashEntry) + sizeof(Command))
+		    * nPtr->cmdTable.numEntries;
+    fpPtr->varBytes += VarTableSize(&nPtr->varTable);
+}
+
+static Tcl_WideInt
+VarTableSize(
+    TclVarHashTable *tablePtr)
+{
+    Tcl_HashSearch search;
+    Tcl_HashEntry *hPtr;
+    Var *varPtr;
+    Tcl_WideInt size = sizeof(Tcl_HashEntry *) * tablePtr->table.numBuckets;
+
+    for (hPtr = Tcl_FirstHashEntry(&tablePtr->table, &search); hPtr != NULL;
+	    hPtr = Tcl_NextHashEntry(&search)) {
+	varPtr = VarHashGetValue(hPtr);
+	size += sizeof(VarInHash);
+	if (TclIsVarArray(varPtr)) {
+	    size += sizeof(TclVarHashTable)
+		    + VarTableSize(varPtr->value.tablePtr);
+	} else if (!TclIsVarLink(varPtr) && varPtr->value.objPtr != NULL) {
+	    size += ValueSize(varPtr->value.objPtr);
+	}
+    }
+    return size;
+}
+
+static Tcl_WideInt
+ValueSize(
+    Tcl_Obj *objPtr)
+{
+    Tcl_WideInt size = sizeof(Tcl_Obj);
+
+    if (objPtr->bytes != NULL) {
+	size += objPtr->length + 1;
+    }
+    return size;
+}
+
 /*
  * Local Variables:
  * mode: c
@@ -97,6 +97,13 @@ typedef struct ProcedureMethod {
     GetFrameInfoValueProc gfivProc;
 				/* Callback to allow for fine tuning of how
 				 * the method reports itself. */
+    ClientData codePtr;		/* The compiled body as of the last time it
+				 * was checked to be valid, or NULL if it
+				 * never has been. */
+    int compileEpoch;		/* The interpreter's compile epoch at that
+				 * time. Together with codePtr, this lets the
+				 * full validity check of the bytecode be
+				 * skipped on most calls. */
 } ProcedureMethod;
 
 #define TCLOO_PROCEDURE_METHOD_VERSION 0
@@ -114,6 +121,124 @@ typedef struct ProcedureMethod {
 
 #define USE_DECLARER_NS		0x80
 
+/*
+ * Statistics gathered when compiling method bodies ahead of time (see
+ * TclOOPrecompileClasses). The counts are accumulated into, so callers must
+ * initialize the structure.
+ */
+
+typedef struct TclOOCompileStats {
+    int numMethods;		/* Number of procedure-like methods seen. */
+    int numCompiled;		/* Number of those that needed compiling. */
+    Tcl_WideInt codeBytes;	/* Total size of the bytecode of the methods
+				 * seen, whether compiled now or earlier. */
+    Tcl_WideInt microseconds;	/* Time spent compiling. */
+} TclOOCompileStats;
+
+/*
+ * Flags for TclOOPrecompileClasses.
+ */
+
+#define PRECOMPILE_SUBCLASSES	1
+
+/*
+ * Approximate memory use of a class and its direct instances, broken down by
+ * category (see TclOOGetClassFootprint). The sizes are in bytes and are
+ * accumulated into, so callers must initialize the structure.
+ */
+
+typedef struct TclOOFootprint {
+    int numInstances;		/* Number of direct instances counted. */
+    Tcl_WideInt structBytes;	/* Object and class records and their lists
+				 * of related classes, filters, etc. */
+    Tcl_WideInt namespaceBytes;	/* Namespaces and the commands in them. */
+    Tcl_WideInt varBytes;	/* Variables in those namespaces. */
+    Tcl_WideInt methodBytes;	/* Methods, including their bodies and
+				 * bytecode. */
+    Tcl_WideInt chainBytes;	/* Call chain caches. */
+    Tcl_WideInt metadataBytes;	/* Metadata tables (not including the
+				 * metadata itself, which is opaque). */
+} TclOOFootprint;
+
+/*
+ * Data collected by the method call profiler (see [oo::profile]). There is
+ * one record for each method that has been called while profiling was
+ * enabled. Each record holds a reference to its method so that the method
+ * structure cannot be reused for a different method while the data exists;
+ * the names are captured when the record is created for the same reason.
+ * All times are in microseconds.
+ */
+
+typedef struct ProfileRecord {
+    Method *mPtr;		/* The method being profiled. */
+    Tcl_Obj *declarerObj;	/* Name of the class or object that declared
+				 * the method. */
+    Tcl_Obj *nameObj;		/* Name of the method. */
+    Tcl_WideInt calls;		/* Number of calls of the method. */
+    Tcl_WideInt nextCalls;	/* Number of those calls that were not the
+				 * first step along their call chain, i.e.,
+				 * that were reached through [next]. */
+    int maxDepth;		/* Deepest step along a call chain at which
+				 * the method has been called. */
+    int active;			/* Number of calls of the method currently in
+				 * progress, so that recursive calls do not
+				 * count towards the inclusive time twice. */
+    Tcl_WideInt inclusive;	/* Time spent in the method, including the
+				 * methods it called. */
+    Tcl_WideInt exclusive;	/* Time spent in the method, excluding the
+				 * methods it called. */
+} ProfileRecord;
+
+/*
+ * Counters describing how well the call chain caches are working (see
+ * [oo::stats]). They are only ever reset on request. The causes of advances
+ * of the global epoch are counted separately, indexed by the EPOCH_* values
+ * below.
+ */
+
+enum TclOOEpochCause {
+    EPOCH_CLASS,		/* Change of the class of an object. */
+    EPOCH_CONSTRUCTOR,		/* Change of a constructor. */
+    EPOCH_DESTRUCTOR,		/* Change of a destructor. */
+    EPOCH_EXPORT,		/* Change of the visibility of a method. */
+    EPOCH_FILTER,		/* Change of the filters of a class. */
+    EPOCH_METHOD,		/* Creation, deletion or renaming of a
+				 * method. */
+    EPOCH_MIXIN,		/* Change of the mixins of a class. */
+    EPOCH_SUPERCLASS,		/* Change of the superclasses of a class. */
+    EPOCH_NUM_CAUSES
+};
+
+typedef struct TclOOStats {
+    Tcl_WideInt intrepHits;	/* Chains found in the method name's internal
+				 * representation. */
+    Tcl_WideInt objectCacheHits;/* Chains found in an object's chain
+				 * cache. */
+    Tcl_WideInt classCacheHits;	/* Chains found in a class's chain cache,
+				 * including constructor and destructor
+				 * chains. */
+    Tcl_WideInt shapeCacheHits;	/* Chains found in the chain cache shared by
+				 * objects of the same shape. */
+    Tcl_WideInt chainsBuilt;	/* Chains that had to be built in full. */
+    Tcl_WideInt unknownChains;	/* Of those, how many had to fall back to the
+				 * unknown method handler. */
+    Tcl_WideInt chainsFreed;	/* Cached chains thrown away, whether because
+				 * they were found to be out of date or
+				 * because their cache was deleted. */
+    Tcl_WideInt epochAdvances;	/* Times the global epoch advanced. */
+    Tcl_WideInt epochBumps[EPOCH_NUM_CAUSES];
+				/* Requests to advance the global epoch, by
+				 * cause. */
+} TclOOStats;
+
+typedef struct ProfileData {
+    Tcl_HashTable records;	/* Map from Method pointers to the
+				 * ProfileRecord describing them. */
+    struct ProfileFrame *framePtr;
+				/* The innermost profiled call that is in
+				 * progress, or NULL if there is none. */
+} ProfileData;
+
 /*
  * Forwarded methods have the following extra information.
  */
@@ -157,6 +282,11 @@ typedef struct Object {
 				 * lot of hash lookups on the critical path
 				 * for object invokation and creation. */
     Tcl_Namespace *namespacePtr;/* This object's tame namespace. */
+    int nsResolverEpoch;	/* The resolution epoch of the namespace once
+				 * it was set up (see SettleNamespace). While
+				 * the namespace is still at this epoch, no
+				 * command that the bytecode compiler knows
+				 * about has been shadowed in it. */
     Tcl_Command command;	/* Reference to this object's public
 				 * command. */
     Tcl_Command myCommand;	/* Reference to this object's internal
@@ -180,7 +310,8 @@ typedef struct Object {
 				 * easier. */
     int epoch;			/* Per-object epoch, incremented when the way
 				 * an object should resolve call chains is
-				 * changed. */
+				 * changed. Use TclOOObjectChanged() to do
+				 * this. */
     Tcl_HashTable *metadataPtr;	/* Mapping from pointers to metadata type to
 				 * the ClientData values that are the values
 				 * of each piece of attached metadata. This
@@ -189,9 +320,39 @@ typedef struct Object {
     Tcl_Obj *cachedNameObj;	/* Cache of the name of the object. */
     Tcl_HashTable *chainCache;	/* Place to keep unused contexts. This table
 				 * is indexed by method name as Tcl_Obj. */
+    Tcl_HashTable *unfilteredChainCache;
+				/* Like chainCache, but for the chains of
+				 * calls made while a filter is running, which
+				 * do not include the filters. */
+    struct CallChain *filterChainPtr[2];
+				/* The resolved filters that start each call
+				 * chain of this object, for non-private and
+				 * private calls respectively. NULL if not
+				 * cached. Not used when the object shares
+				 * its class's chain cache. */
+    struct ObjectShape *shapePtr;
+				/* The shape whose chain cache this object
+				 * uses, or NULL if it does not use one (or
+				 * has not been called since it last changed).
+				 * Only objects whose dispatch is changed
+				 * solely by mixins and filters have a shape.
+				 * Shapes are immutable; an object that is
+				 * changed leaves its shape. */
     Tcl_ObjectMapMethodNameProc *mapMethodNameProc;
 				/* Function to allow remapping of method
 				 * names. For itcl-ng. */
+    Tcl_ObjectMapMethodNameProc2 *mapMethodNameProc2;
+				/* Function to allow remapping of method
+				 * names whose results depend only on the
+				 * name and on the definitions of the object
+				 * and its classes, and so can be remembered.
+				 * Only one of this and mapMethodNameProc is
+				 * set at a time. */
+    Tcl_HashTable *mappedNameCache;
+				/* Remembered results of mapMethodNameProc2,
+				 * indexed by method name as Tcl_Obj; values
+				 * are MappedName structures. NULL if nothing
+				 * has been mapped. */
     LIST_STATIC(Tcl_Obj *) variables;
 } Object;
 
@@ -202,6 +363,11 @@ typedef struct Object {
 #define CLASS_GONE	4	/* Indicates that the class of this object has
 				 * been deleted, and so the object should not
 				 * attempt to remove itself from its class. */
+#define WEAKLY_REFERENCED 8	/* Indicates that the object is in the
+				 * foundation's weakRefTable. */
+#define OBJECT_POOLED 0x10	/* Indicates that the object has been destroyed
+				 * and its shell is in its class's pool,
+				 * waiting to be reused by a new instance. */
 #define ROOT_OBJECT 0x1000	/* Flag to say that this object is the root of
 				 * the class hierarchy and should be treated
 				 * specially during teardown. */
@@ -219,6 +385,9 @@ typedef struct Object {
 				 * other spots). */
 #define FORCE_UNKNOWN 0x10000	/* States that we are *really* looking up the
 				 * unknown method handler at that point. */
+#define USE_SHAPE_CACHE 0x20000	/* Flag set on call chains built for an
+				 * object shape rather than for an object or
+				 * class. */
 
 /*
  * And the definition of a class. Note that every class also has an associated
@@ -277,9 +446,77 @@ typedef struct Class {
 				 * object doesn't override with its own mixins
 				 * (and filters and method implementations for
 				 * when getting method chains). */
+    Tcl_HashTable *unfilteredChainCache;
+				/* Like classChainCache, but for the chains of
+				 * calls made while a filter is running, which
+				 * do not include the filters. */
+    struct CallChain *filterChainPtr[2];
+				/* The resolved filters that start the call
+				 * chains of instances that use the class
+				 * chain cache, for non-private and private
+				 * calls respectively. NULL if not cached. */
+    int *ancestors;		/* Sorted array of the creation epochs of the
+				 * objects of all classes reachable from this
+				 * one through superclasses and mixins, itself
+				 * included, or NULL if not worked out. */
+    int numAncestors;		/* Number of entries in ancestors. */
+    int ancestryEpoch;		/* The foundation's ancestryEpoch when the
+				 * ancestors were worked out. */
     LIST_STATIC(Tcl_Obj *) variables;
+    int poolSize;		/* Maximum number of destroyed instances whose
+				 * shells are kept for reuse, or 0 if the
+				 * class does not pool its instances. */
+    LIST_STATIC(Object *) pool;	/* The pooled shells; the list has room for
+				 * poolSize entries, and is only allocated
+				 * when the first shell is pooled. */
+    Object **instanceIndex;	/* The instances that have commands, sorted
+				 * by name, for the searches done by [info
+				 * class instances]; NULL until first needed.
+				 * Has space for instances.size entries. */
+    int numIndexed;		/* Number of entries in instanceIndex. */
 } Class;
 
+/*
+ * The shape of an object that is not a pure instance of its class, but whose
+ * dispatch is only changed by mixins and filters (not by methods of its
+ * own). All objects with the same class, mixins and filters have the same
+ * call chains, so they share the chain caches kept in their shape. Shapes
+ * are only used for sharing call chains: objects with methods of their own
+ * have no shape, and declared variables are not part of a shape. An object
+ * is detached from its shape whenever it changes (see TclOOObjectChanged)
+ * and is given its new shape when it is next called.
+ */
+
+typedef struct ObjectShape {
+    Tcl_HashEntry *hPtr;	/* Entry in the foundation's table of shapes,
+				 * keyed by a description of the shape. */
+    int refCount;		/* Number of objects with this shape. */
+    int id;			/* Unique value identifying the call chains
+				 * built for this shape. */
+    Tcl_HashTable *chainCache;	/* Call chains of objects with this shape,
+				 * indexed by method name as Tcl_Obj. */
+    Tcl_HashTable *unfilteredChainCache;
+				/* Likewise, for calls made while a filter is
+				 * running. */
+    struct CallChain *filterChainPtr[2];
+				/* The resolved filters that start the call
+				 * chains of this shape, for non-private and
+				 * private calls respectively. */
+} ObjectShape;
+
+/*
+ * A remembered result of a (version 2) method name mapper. It is only used
+ * while the global and object epochs are what they were when it was made.
+ */
+
+typedef struct MappedName {
+    Tcl_Obj *nameObj;		/* The name to look the method up by. */
+    Class *startCls;		/* The class to start the chain at, or NULL
+				 * for the whole chain. Reference counted. */
+    int epoch;			/* Global epoch when mapped. */
+    int objectEpoch;		/* Object epoch when mapped. */
+} MappedName;
+
 /*
  * The foundation of the object system within an interpreter contains
  * references to the key classes and namespaces, together with a few other
@@ -326,6 +563,38 @@ typedef struct Foundation {
     Tcl_Obj *clonedName;	/* Shared object containing the name of a
 				 * "<cloned>" pseudo-constructor. */
     Tcl_Obj *defineName;	/* Fully qualified name of oo::define. */
+    Tcl_Obj *filterLiteral;	/* Shared objects containing the words used */
+    Tcl_Obj *methodLiteral;	/* in descriptions of call chains. */
+    Tcl_Obj *objectLiteral;
+    const Tcl_ObjType *byteCodeTypePtr;
+				/* The type of compiled scripts, used to check
+				 * whether method bodies are compiled. */
+    int profiling;		/* Whether method calls are being profiled.
+				 * This is the only thing checked on the call
+				 * path when profiling is disabled. */
+    ProfileData *profilePtr;	/* The data gathered by the most recent
+				 * profiling run, or NULL if there has not
+				 * been one. */
+    TclOOStats stats;		/* Call chain cache statistics. */
+    int numObjects;		/* Number of objects (including classes) that
+				 * currently exist. */
+    int numClasses;		/* Number of classes that currently exist. */
+    Tcl_HashTable shapeTable;	/* Map from descriptions of object shapes to
+				 * the ObjectShape structures. */
+    int shapeCount;		/* Counter used to give shapes unique ids. */
+    Tcl_HashTable weakRefTable;	/* Map from creationEpoch to object, for all
+				 * live objects that weak references have
+				 * been made to. */
+    int ancestryEpoch;		/* Incremented whenever the superclasses or
+				 * mixins of any class change, invalidating
+				 * the classes' memoized ancestors. */
+    int classNameEpoch;		/* Incremented whenever a class is renamed,
+				 * invalidating the descriptions of call
+				 * chains that mention it. */
+    int nsSetupEpoch;		/* The resolution epoch that the namespaces
+				 * of objects and classes are brought to once
+				 * they are set up; that of the namespace of
+				 * oo::class when it was set up. */
 } Foundation;
 
 /*
@@ -360,6 +629,11 @@ typedef struct CallChain {
 				 * staticChain if the number of entries is
 				 * small. */
     struct MInvoke staticChain[CALL_CHAIN_STATIC_SIZE];
+    Tcl_Obj *descObj;		/* The description of the chain produced by
+				 * TclOORenderCallChain, or NULL if not yet
+				 * made. */
+    int descEpoch;		/* Foundation's classNameEpoch when the
+				 * description was made. */
 } CallChain;
 
 typedef struct CallContext {
@@ -438,6 +712,9 @@ MODULE_SCOPE int	TclOODefineForwardObjCmd(ClientData clientData,
 MODULE_SCOPE int	TclOODefineMethodObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOODefinePoolObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
 MODULE_SCOPE int	TclOODefineRenameMethodObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv);
@@ -456,6 +733,21 @@ MODULE_SCOPE int	TclOOUnknownDefinition(ClientData clientData,
 MODULE_SCOPE int	TclOOCopyObjectCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOOIsAObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOOWeakRefObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOOPrecompileObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOOProfileObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
+MODULE_SCOPE int	TclOOStatsObjCmd(ClientData clientData,
+			    Tcl_Interp *interp, int objc,
+			    Tcl_Obj *const *objv);
 MODULE_SCOPE int	TclOONextObjCmd(ClientData clientData,
 			    Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv);
@@ -506,10 +798,14 @@ MODULE_SCOPE int	TclOO_Object_VarName(ClientData clientData,
 MODULE_SCOPE void	TclOOAddToInstances(Object *oPtr, Class *clsPtr);
 MODULE_SCOPE void	TclOOAddToMixinSubs(Class *subPtr, Class *mixinPtr);
 MODULE_SCOPE void	TclOOAddToSubclasses(Class *subPtr, Class *superPtr);
+MODULE_SCOPE Tcl_WideInt TclOOChainCacheSize(Foundation *fPtr);
+MODULE_SCOPE Tcl_WideInt TclOOChainSize(CallChain *callPtr);
+MODULE_SCOPE Tcl_WideInt TclOOChainTableSize(Tcl_HashTable *tablePtr);
 MODULE_SCOPE int	TclOODefineSlots(Foundation *fPtr);
 MODULE_SCOPE void	TclOODeleteChain(CallChain *callPtr);
-MODULE_SCOPE void	TclOODeleteChainCache(Tcl_HashTable *tablePtr);
+MODULE_SCOPE int	TclOODeleteChainCache(Tcl_HashTable *tablePtr);
 MODULE_SCOPE void	TclOODeleteContext(CallContext *contextPtr);
+MODULE_SCOPE void	TclOODeleteProfileData(ProfileData *dataPtr);
 MODULE_SCOPE void	TclOODelMethodRef(Method *method);
 MODULE_SCOPE CallContext *TclOOGetCallContext(Object *oPtr,
 			    Tcl_Obj *methodNameObj, int flags);
@@ -523,13 +819,19 @@ MODULE_SCOPE int	TclOOGetSortedClassMethodList(Class *clsPtr,
 			    int flags, const char ***stringsPtr);
 MODULE_SCOPE int	TclOOGetSortedMethodList(Object *oPtr, int flags,
 			    const char ***stringsPtr);
+MODULE_SCOPE void	TclOOIndexInstance(Class *clsPtr, Object *oPtr);
 MODULE_SCOPE void	TclOOInitInfo(Tcl_Interp *interp);
 MODULE_SCOPE int	TclOOInvokeContext(Tcl_Interp *interp,
 			    CallContext *contextPtr, int objc,
 			    Tcl_Obj *const *objv);
+MODULE_SCOPE Object *	TclOOLookupObject(Tcl_Interp *interp,
+			    Tcl_Obj *objPtr);
+MODULE_SCOPE Tcl_WideInt TclOOMethodSize(Method *mPtr);
+MODULE_SCOPE const char *TclOOMethodTypeName(Method *mPtr);
 MODULE_SCOPE void	TclOONewBasicMethod(Tcl_Interp *interp, Class *clsPtr,
 			    const DeclaredClassMethod *dcm);
 MODULE_SCOPE Tcl_Obj *	TclOOObjectName(Tcl_Interp *interp, Object *oPtr);
+MODULE_SCOPE void	TclOOReleaseShape(Object *oPtr);
 MODULE_SCOPE void	TclOORemoveFromInstances(Object *oPtr, Class *clsPtr);
 MODULE_SCOPE void	TclOORemoveFromMixinSubs(Class *subPtr,
 			    Class *mixinPtr);
@@ -537,9 +839,13 @@ MODULE_SCOPE void	TclOORemoveFromSubclasses(Class *subPtr,
 			    Class *superPtr);
 MODULE_SCOPE Tcl_Obj *	TclOORenderCallChain(Tcl_Interp *interp,
 			    CallChain *callPtr);
+MODULE_SCOPE void	TclOOStartProfiling(Foundation *fPtr);
 MODULE_SCOPE void	TclOOStashContext(Tcl_Obj *objPtr,
 			    CallContext *contextPtr);
+MODULE_SCOPE void	TclOOSetPoolSize(Class *clsPtr, int size);
 MODULE_SCOPE void	TclOOSetupVariableResolver(Tcl_Namespace *nsPtr);
+MODULE_SCOPE void	TclOOUnindexInstance(Class *clsPtr, Object *oPtr,
+			    const char *name);
 
 /*
  * Include all the private API, generated from tclOO.decls.
@@ -604,6 +910,41 @@ MODULE_SCOPE void	TclOOSetupVariableResolver(Tcl_Namespace *nsPtr);
 	}					\
     } while(0)
 
+/*
+ * Advance the global epoch, invalidating all cached call chains (lazily; they
+ * are only thrown away when next looked up), and record why.
+ */
+
+#define TclOOBumpEpoch(fPtr, cause) do {	\
+	(fPtr)->stats.epochBumps[cause]++;	\
+	(fPtr)->epoch++;			\
+	(fPtr)->stats.epochAdvances++;		\
+    } while(0)
+
+/*
+ * Record that the way a single object dispatches its methods has changed. Its
+ * own cached call chains become invalid, and it leaves its shape at once; it
+ * moves to its new shape (if it can have one) when it is next called.
+ */
+
+#define TclOOObjectChanged(oPtr) do {		\
+	(oPtr)->epoch++;			\
+	TclOOReleaseShape(oPtr);		\
+    } while(0)
+
+/*
+ * Throw away a class's index of its instances' names. It is made again from
+ * the list of instances when it is next needed.
+ */
+
+#define TclOOForgetInstanceIndex(clsPtr) do {		\
+	if ((clsPtr)->instanceIndex != NULL) {		\
+	    ckfree((char *) (clsPtr)->instanceIndex);	\
+	    (clsPtr)->instanceIndex = NULL;		\
+	    (clsPtr)->numIndexed = 0;			\
+	}						\
+    } while(0)
+
 #endif /* TCL_OO_INTERNAL_H */
 
 /*
@@ -88,6 +88,15 @@ EXTERN void		TclOOObjectSetMixins(Object *oPtr, int numMixins,
 EXTERN void		TclOOClassSetMixins(Tcl_Interp *interp,
 				Class *classPtr, int numMixins,
 				Class *const *mixins);
+/* 16 */
+EXTERN int		TclOOPrecompileClasses(Tcl_Interp *interp,
+				int numClasses, Class *const *classes,
+				int flags, TclOOCompileStats *statsPtr);
+/* 17 */
+EXTERN Tcl_Obj *	TclOOProfileReport(Tcl_Interp *interp);
+/* 18 */
+EXTERN void		TclOOGetClassFootprint(Class *clsPtr,
+				TclOOFootprint *fpPtr);
 
 typedef struct TclOOIntStubs {
     int magic;
@@ -109,6 +118,9 @@ typedef struct TclOOIntStubs {
     void (*tclOOClassSetFilters) (Tcl_Interp *interp, Class *classPtr, int numFilters, Tcl_Obj *const *filters); /* 13 */
     void (*tclOOObjectSetMixins) (Object *oPtr, int numMixins, Class *const *mixins); /* 14 */
     void (*tclOOClassSetMixins) (Tcl_Interp *interp, Class *classPtr, int numMixins, Class *const *mixins); /* 15 */
+    int (*tclOOPrecompileClasses) (Tcl_Interp *interp, int numClasses, Class *const *classes, int flags, TclOOCompileStats *statsPtr); /* 16 */
+    Tcl_Obj * (*tclOOProfileReport) (Tcl_Interp *interp); /* 17 */
+    void (*tclOOGetClassFootprint) (Class *clsPtr, TclOOFootprint *fpPtr); /* 18 */
 } TclOOIntStubs;
 
 extern const TclOOIntStubs *tclOOIntStubsPtr;
@@ -155,6 +167,12 @@ extern const TclOOIntStubs *tclOOIntStubsPtr;
 	(tclOOIntStubsPtr->tclOOObjectSetMixins) /* 14 */
 #define TclOOClassSetMixins \
 	(tclOOIntStubsPtr->tclOOClassSetMixins) /* 15 */
+#define TclOOPrecompileClasses \
+	(tclOOIntStubsPtr->tclOOPrecompileClasses) /* 16 */
+#define TclOOProfileReport \
+	(tclOOIntStubsPtr->tclOOProfileReport) /* 17 */
+#define TclOOGetClassFootprint \
+	(tclOOIntStubsPtr->tclOOGetClassFootprint) /* 18 */
 
 #endif /* defined(USE_TCLOO_STUBS) */
 
@@ -13,6 +13,7 @@
 #include "config.h"
 #endif
 #include "tclInt.h"
+#include "tclCompile.h"
 #include "tclOOInt.h"
 
 /*
@@ -58,10 +59,46 @@ typedef struct {
 				 * variables be cached? */
 } OOResVarInfo;
 
+/*
+ * Structure used to hold a method of a version 2 method type, where TclOO
+ * checks and converts the arguments. The defaults are made into values once,
+ * when the method is created, so that their conversions are cached too.
+ */
+
+typedef struct {
+    const Tcl_MethodType2 *typePtr;
+				/* The real type of the method. */
+    ClientData clientData;	/* The real client data of the method. */
+    int numArgs;		/* Number of declared arguments. */
+    int minArgs;		/* Number of those that are required. */
+    Tcl_Obj **defaults;		/* Default values of the arguments, or NULL
+				 * entries where there are none. */
+    Tcl_Obj *usageObj;		/* Argument description for wrong # args
+				 * messages. */
+} ArgMethod;
+
+/*
+ * Number of converted arguments that are held on the C stack when calling a
+ * method of a version 2 method type.
+ */
+
+#define ARG_METHOD_STATIC_SIZE 8
+
 /*
  * Function declarations for things defined in this file.
  */
 
+static void		WrapArgMethod(const Tcl_MethodType **typePtrPtr,
+			    ClientData *clientDataPtr);
+static ArgMethod *	NewArgMethod(const Tcl_MethodType2 *typePtr,
+			    ClientData clientData);
+static int		InvokeArgMethod(ClientData clientData,
+			    Tcl_Interp *interp, Tcl_ObjectContext context,
+			    int objc, Tcl_Obj *const *objv);
+static void		DeleteArgMethod(ClientData clientData);
+static int		CloneArgMethod(Tcl_Interp *interp,
+			    ClientData clientData, ClientData *newClientData);
+
 static Tcl_Obj **	InitEnsembleRewrite(Tcl_Interp *interp, int objc,
 			    Tcl_Obj *const *objv, int toRewrite,
 			    int rewriteLength, Tcl_Obj *const *rewriteObjs,
@@ -69,6 +106,13 @@ static Tcl_Obj **	InitEnsembleRewrite(Tcl_Interp *interp, int objc,
 static int		InvokeProcedureMethod(ClientData clientData,
 			    Tcl_Interp *interp, Tcl_ObjectContext context,
 			    int objc, Tcl_Obj *const *objv);
+static inline int	CompileMethodBody(Tcl_Interp *interp,
+			    ProcedureMethod *pmPtr, Tcl_Namespace *nsPtr,
+			    const char *namePtr);
+static inline int	IsBodyCompiled(Tcl_Interp *interp,
+			    ProcedureMethod *pmPtr, Tcl_Namespace *nsPtr);
+static int		PrecompileMethod(Tcl_Interp *interp, Method *mPtr,
+			    Class *clsPtr, TclOOCompileStats *statsPtr);
 static int		PushMethodCallFrame(Tcl_Interp *interp,
 			    CallContext *contextPtr, ProcedureMethod *pmPtr,
 			    int objc, Tcl_Obj *const *objv,
@@ -90,6 +134,9 @@ static int		InvokeForwardMethod(ClientData clientData,
 static void		DeleteForwardMethod(ClientData clientData);
 static int		CloneForwardMethod(Tcl_Interp *interp,
 			    ClientData clientData, ClientData *newClientData);
+static int		ProcedureMethodCmdResolver(Tcl_Interp *interp,
+			    const char *name, Tcl_Namespace *contextNs,
+			    int flags, Tcl_Command *cmdPtr);
 static int		ProcedureMethodVarResolver(Tcl_Interp *interp,
 			    const char *varName, Tcl_Namespace *contextNs,
 			    int flags, Tcl_Var *varPtr);
@@ -110,6 +157,10 @@ static const Tcl_MethodType fwdMethodType = {
     TCL_OO_METHOD_VERSION_CURRENT, "forward",
     InvokeForwardMethod, DeleteForwardMethod, CloneForwardMethod
 };
+static const Tcl_MethodType argMethodType = {
+    TCL_OO_METHOD_VERSION_CURRENT, "argument-checked method",
+    InvokeArgMethod, DeleteArgMethod, CloneArgMethod
+};
 
 /*
  * Helper macros (derived from things private to tclVar.c)
@@ -177,6 +228,7 @@ Tcl_NewInstanceMethod(
     }
 
   populate:
+    WrapArgMethod(&typePtr, &clientData);
     mPtr->typePtr = typePtr;
     mPtr->clientData = clientData;
     mPtr->flags = 0;
@@ -185,7 +237,7 @@ Tcl_NewInstanceMethod(
     if (flags) {
 	mPtr->flags |= flags & (PUBLIC_METHOD | PRIVATE_METHOD);
     }
-    oPtr->epoch++;
+    TclOOObjectChanged(oPtr);
     return (Tcl_Method) mPtr;
 }
 
@@ -240,7 +292,8 @@ Tcl_NewMethod(
     }
 
   populate:
-    clsPtr->thisPtr->fPtr->epoch++;
+    TclOOBumpEpoch(clsPtr->thisPtr->fPtr, EPOCH_METHOD);
+    WrapArgMethod(&typePtr, &clientData);
     mPtr->typePtr = typePtr;
     mPtr->clientData = clientData;
     mPtr->flags = 0;
@@ -706,6 +759,12 @@ InvokeProcedureMethod(
      * Now invoke the body of the method. Note that we need to take special
      * action when doing unknown processing to ensure that the missing method
      * name is passed as an argument.
+     *
+     * The binding of the arguments to the formal parameters is done by the
+     * core, which works from the compiled locals made for the formal
+     * parameters (including their default values) when the procedure was
+     * created; all that varies from call to call is where the arguments
+     * start, which is what skip says.
      */
 
     skip = Tcl_ObjectContextSkippedArgs(context);
@@ -753,10 +812,12 @@ PushMethodCallFrame(
 				 * frame. */
 {
     Tcl_Namespace *nsPtr = contextPtr->oPtr->namespacePtr;
+    Tcl_Namespace *compileNsPtr;
+    Object *declarerPtr;
+    register Method *mPtr = contextPtr->callPtr->chain[contextPtr->index].mPtr;
     register int result;
     const char *namePtr;
     CallFrame **framePtrPtr = &fdPtr->framePtr;
-    static Tcl_ObjType *byteCodeTypePtr = NULL;	/* HACK! */
 
     /*
      * Compute basic information on the basis of the type of method it is.
@@ -785,15 +846,37 @@ PushMethodCallFrame(
      * their class's namespace.
      */
 
+    if (mPtr->declaringClassPtr != NULL) {
+	declarerPtr = mPtr->declaringClassPtr->thisPtr;
+    } else {
+	declarerPtr = mPtr->declaringObjectPtr;
+    }
+    compileNsPtr = declarerPtr->namespacePtr;
     if (pmPtr->flags & USE_DECLARER_NS) {
-	register Method *mPtr =
-		contextPtr->callPtr->chain[contextPtr->index].mPtr;
+	nsPtr = compileNsPtr;
+    }
 
-	if (mPtr->declaringClassPtr != NULL) {
-	    nsPtr = mPtr->declaringClassPtr->thisPtr->namespacePtr;
-	} else {
-	    nsPtr = mPtr->declaringObjectPtr->namespacePtr;
-	}
+    /*
+     * The body is compiled against the namespace of the declarer, not that
+     * of the object, so that calling the method on many different objects
+     * does not make the bytecode thrash between their namespaces. That is
+     * only equivalent when neither namespace has had any compiled command
+     * shadowed in it since TclOO set it up (its resolution epoch has not
+     * moved on since then), and the two epochs are the same so that the
+     * bytecode engine accepts the code in either (TclOO brings all the
+     * namespaces it sets up to the same epoch; see SettleNamespace); in all
+     * other cases, we compile against the namespace the body will run in.
+     */
+
+    if (compileNsPtr == NULL || compileNsPtr == nsPtr
+	    || (((Namespace *) compileNsPtr)->flags & (NS_DYING|NS_DEAD))
+	    || ((Namespace *) compileNsPtr)->resolverEpoch
+		    != declarerPtr->nsResolverEpoch
+	    || ((Namespace *) nsPtr)->resolverEpoch
+		    != contextPtr->oPtr->nsResolverEpoch
+	    || ((Namespace *) nsPtr)->resolverEpoch
+		    != ((Namespace *) compileNsPtr)->resolverEpoch) {
+	compileNsPtr = nsPtr;
     }
 
     /*
@@ -814,18 +897,9 @@ PushMethodCallFrame(
     fdPtr->cmd.clientData = &fdPtr->efi;
     pmPtr->procPtr->cmdPtr = &fdPtr->cmd;
 
-    /* Should be a reference to tclByteCodeType, but that's MODULE_SCOPE */
-    if (byteCodeTypePtr == NULL ||
-	    pmPtr->procPtr->bodyPtr->typePtr != byteCodeTypePtr) {
-	result = TclProcCompileProc(interp, pmPtr->procPtr,
-		pmPtr->procPtr->bodyPtr, (Namespace *) nsPtr,
-		"body of method", namePtr);
-	if (result != TCL_OK) {
-	    return result;
-	}
-	if (byteCodeTypePtr == NULL) {
-	    byteCodeTypePtr = pmPtr->procPtr->bodyPtr->typePtr;
-	}
+    result = CompileMethodBody(interp, pmPtr, compileNsPtr, namePtr);
+    if (result != TCL_OK) {
+	return result;
     }
 
     /*
@@ -872,6 +946,63 @@ PushMethodCallFrame(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * IsBodyCompiled, CompileMethodBody --
+ *
+ *	Make sure that the body of a procedure-like method is compiled. The
+ *	full check of whether the bytecode is still valid (which is done by
+ *	TclProcCompileProc) is only needed if the bytecode has changed, the
+ *	interpreter's compile epoch has advanced, or the body was compiled
+ *	against a different namespace (or an earlier resolution epoch of the
+ *	same one); otherwise, the bytecode can be used as it is. Bytecode is
+ *	only shared between instances because PushMethodCallFrame compiles
+ *	against the declaring class's namespace, whose epoch matches that of
+ *	the instances' namespaces (see SettleNamespace); a body compiled
+ *	against an instance's own namespace is compiled again for the next.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static inline int
+IsBodyCompiled(
+    Tcl_Interp *interp,
+    ProcedureMethod *pmPtr,
+    Tcl_Namespace *nsPtr)
+{
+    Tcl_Obj *bodyPtr = pmPtr->procPtr->bodyPtr;
+
+    return (pmPtr->compileEpoch == ((Interp *) interp)->compileEpoch
+	    && bodyPtr->typePtr == TclOOGetFoundation(interp)->byteCodeTypePtr
+	    && bodyPtr->internalRep.otherValuePtr == pmPtr->codePtr
+	    && ((ByteCode *) pmPtr->codePtr)->nsPtr == (Namespace *) nsPtr
+	    && ((ByteCode *) pmPtr->codePtr)->nsEpoch
+		    == ((Namespace *) nsPtr)->resolverEpoch);
+}
+
+static inline int
+CompileMethodBody(
+    Tcl_Interp *interp,
+    ProcedureMethod *pmPtr,
+    Tcl_Namespace *nsPtr,
+    const char *namePtr)
+{
+    Tcl_Obj *bodyPtr = pmPtr->procPtr->bodyPtr;
+    int result;
+
+    if (IsBodyCompiled(interp, pmPtr, nsPtr)) {
+	return TCL_OK;
+    }
+    result = TclProcCompileProc(interp, pmPtr->procPtr, bodyPtr,
+	    (Namespace *) nsPtr, "body of method", namePtr);
+    if (result == TCL_OK) {
+	pmPtr->codePtr = bodyPtr->internalRep.otherValuePtr;
+	pmPtr->compileEpoch = ((Interp *) interp)->compileEpoch;
+    }
+    return result;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -883,6 +1014,13 @@ PushMethodCallFrame(
  *	that is only referred to in ways that aren't compilable and we can't
  *	force LVT presence. [TIP #320]
  *
+ *	A command resolver is installed alongside them that goes straight to
+ *	the [my], [self] and [next] commands of the object whose method is
+ *	running. The bytecode of a method body is shared between all the
+ *	objects it is used on, so the cached resolution of those names in it
+ *	is only good for one object at a time; this makes resolving them
+ *	again for each object that the method is called on cheap.
+ *
  * ----------------------------------------------------------------------
  */
 
@@ -894,11 +1032,85 @@ TclOOSetupVariableResolver(
 
     Tcl_GetNamespaceResolvers(nsPtr, &info);
     if (info.compiledVarResProc == NULL) {
-	Tcl_SetNamespaceResolvers(nsPtr, NULL, ProcedureMethodVarResolver,
+	Tcl_SetNamespaceResolvers(nsPtr, ProcedureMethodCmdResolver,
+		ProcedureMethodVarResolver,
 		ProcedureMethodCompiledVarResolver);
     }
 }
 
+static int
+ProcedureMethodCmdResolver(
+    Tcl_Interp *interp,
+    const char *name,
+    Tcl_Namespace *contextNs,
+    int flags,
+    Tcl_Command *cmdPtr)
+{
+    Interp *iPtr = (Interp *) interp;
+    CallFrame *framePtr = iPtr->varFramePtr;
+    Namespace *nsPtr = (Namespace *) contextNs;
+    Object *oPtr;
+    Command *myPtr;
+    Tcl_Namespace *helpersNs;
+    Tcl_HashEntry *hPtr;
+
+    /*
+     * Only the unqualified names of the helper commands are handled, and
+     * only when called from a method of the object that owns the namespace
+     * (which is the only time they do anything useful).
+     */
+
+    if (name[0] == 'm') {
+	if (name[1] != 'y' || name[2] != '\0') {
+	    return TCL_CONTINUE;
+	}
+    } else if (strcmp(name, "self") && strcmp(name, "next")) {
+	return TCL_CONTINUE;
+    }
+    if ((flags & TCL_GLOBAL_ONLY) || framePtr == NULL
+	    || !(framePtr->isProcCallFrame & FRAME_IS_METHOD)) {
+	return TCL_CONTINUE;
+    }
+    oPtr = ((CallContext *) framePtr->clientData)->oPtr;
+    if (oPtr->namespacePtr != contextNs) {
+	return TCL_CONTINUE;
+    }
+
+    /*
+     * [my] is the object's own command, provided that it is still in its
+     * namespace under its own name.
+     */
+
+    myPtr = (Command *) oPtr->myCommand;
+    if (myPtr == NULL || myPtr->nsPtr != nsPtr || myPtr->hPtr == NULL
+	    || strcmp(Tcl_GetHashKey(&nsPtr->cmdTable, myPtr->hPtr), "my")) {
+	return TCL_CONTINUE;
+    }
+    if (name[0] == 'm') {
+	*cmdPtr = (Tcl_Command) myPtr;
+	return TCL_OK;
+    }
+
+    /*
+     * [self] and [next] come from the helper namespace, provided that the
+     * object's namespace has no command other than [my] (checked above)
+     * that could hide them and has not had its path changed.
+     */
+
+    helpersNs = oPtr->fPtr->helpersNs;
+    if (helpersNs == NULL || nsPtr->cmdTable.numEntries != 1
+	    || nsPtr->commandPathLength != 1
+	    || nsPtr->commandPathArray[0].nsPtr != (Namespace *) helpersNs) {
+	return TCL_CONTINUE;
+    }
+    hPtr = Tcl_FindHashEntry(&((Namespace *) helpersNs)->cmdTable, name);
+    if (hPtr == NULL) {
+	return TCL_CONTINUE;
+    }
+    *cmdPtr = Tcl_GetHashValue(hPtr);
+    return TCL_OK;
+}
+
 static int
 ProcedureMethodVarResolver(
     Tcl_Interp *interp,
@@ -1454,6 +1666,251 @@ CloneForwardMethod(
     return TCL_OK;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * WrapArgMethod, NewArgMethod --
+ *
+ *	How methods of version 2 method types are created. They are held as
+ *	methods of an internal (version 1) type whose client data describes
+ *	the real type and client data, and the arguments.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+WrapArgMethod(
+    const Tcl_MethodType **typePtrPtr,
+    ClientData *clientDataPtr)
+{
+    if (*typePtrPtr != NULL
+	    && (*typePtrPtr)->version == TCL_OO_METHOD_VERSION_2) {
+	*clientDataPtr = NewArgMethod(
+		(const Tcl_MethodType2 *) *typePtrPtr, *clientDataPtr);
+	*typePtrPtr = &argMethodType;
+    }
+}
+
+static ArgMethod *
+NewArgMethod(
+    const Tcl_MethodType2 *typePtr,
+    ClientData clientData)
+{
+    ArgMethod *amPtr = (ArgMethod *) ckalloc(sizeof(ArgMethod));
+    const Tcl_MethodArgSpec *specPtr;
+    int i;
+
+    amPtr->typePtr = typePtr;
+    amPtr->clientData = clientData;
+    amPtr->numArgs = 0;
+    amPtr->minArgs = 0;
+    for (specPtr=typePtr->argSpecs ; specPtr!=NULL
+	    && specPtr->type!=TCL_OO_ARG_END ; specPtr++) {
+	if (!(specPtr->type & TCL_OO_ARG_OPTIONAL)) {
+	    if (amPtr->minArgs != amPtr->numArgs) {
+		Tcl_Panic("method type \"%s\": required argument \"%s\" "
+			"follows an optional argument", typePtr->name,
+			specPtr->name);
+	    }
+	    amPtr->minArgs++;
+	}
+	amPtr->numArgs++;
+    }
+
+    amPtr->defaults = NULL;
+    amPtr->usageObj = Tcl_NewObj();
+    Tcl_IncrRefCount(amPtr->usageObj);
+    if (amPtr->numArgs > 0) {
+	amPtr->defaults = (Tcl_Obj **)
+		ckalloc(sizeof(Tcl_Obj *) * amPtr->numArgs);
+    }
+    for (i=0 ; i<amPtr->numArgs ; i++) {
+	specPtr = &typePtr->argSpecs[i];
+	amPtr->defaults[i] = NULL;
+	if (specPtr->defaultValue != NULL) {
+	    amPtr->defaults[i] = Tcl_NewStringObj(specPtr->defaultValue, -1);
+	    Tcl_IncrRefCount(amPtr->defaults[i]);
+	}
+	if (i > 0) {
+	    Tcl_AppendToObj(amPtr->usageObj, " ", 1);
+	}
+	if (i >= amPtr->minArgs) {
+	    Tcl_AppendStringsToObj(amPtr->usageObj, "?", specPtr->name, "?",
+		    NULL);
+	} else {
+	    Tcl_AppendToObj(amPtr->usageObj, specPtr->name, -1);
+	}
+    }
+    return amPtr;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * InvokeArgMethod --
+ *
+ *	How to invoke a method of a version 2 method type. Checks the number
+ *	of arguments and converts each to the declared type before calling
+ *	the real implementation. The conversions are all done by the standard
+ *	functions, so they are cached in the argument values.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+InvokeArgMethod(
+    ClientData clientData,	/* Pointer to some per-method context. */
+    Tcl_Interp *interp,
+    Tcl_ObjectContext context,	/* The method calling context. */
+    int objc,			/* Number of arguments. */
+    Tcl_Obj *const *objv)	/* Arguments as actually seen. */
+{
+    ArgMethod *amPtr = clientData;
+    Tcl_MethodArg staticArgs[ARG_METHOD_STATIC_SIZE], *args = staticArgs;
+    const Tcl_MethodArgSpec *specPtr;
+    int skip = Tcl_ObjectContextSkippedArgs(context);
+    int numGiven = objc - skip;
+    int i, result = TCL_ERROR;
+
+    if (numGiven < amPtr->minArgs || numGiven > amPtr->numArgs) {
+	Tcl_WrongNumArgs(interp, skip, objv,
+		Tcl_GetString(amPtr->usageObj));
+	return TCL_ERROR;
+    }
+    if (amPtr->numArgs > ARG_METHOD_STATIC_SIZE) {
+	args = (Tcl_MethodArg *)
+		ckalloc(sizeof(Tcl_MethodArg) * amPtr->numArgs);
+    }
+
+    for (i=0 ; i<amPtr->numArgs ; i++) {
+	Tcl_MethodArg *argPtr = &args[i];
+
+	specPtr = &amPtr->typePtr->argSpecs[i];
+	memset(argPtr, 0, sizeof(Tcl_MethodArg));
+	argPtr->objPtr = (i < numGiven ? objv[skip+i] : amPtr->defaults[i]);
+	if (argPtr->objPtr == NULL) {
+	    continue;
+	}
+
+	switch (specPtr->type & TCL_OO_ARG_TYPE_MASK) {
+	case TCL_OO_ARG_INT:
+	    if (Tcl_GetIntFromObj(interp, argPtr->objPtr,
+		    &argPtr->intValue) != TCL_OK) {
+		goto badArgument;
+	    }
+	    break;
+	case TCL_OO_ARG_DOUBLE:
+	    if (Tcl_GetDoubleFromObj(interp, argPtr->objPtr,
+		    &argPtr->doubleValue) != TCL_OK) {
+		goto badArgument;
+	    }
+	    break;
+	case TCL_OO_ARG_STRING:
+	    argPtr->stringValue = Tcl_GetStringFromObj(argPtr->objPtr,
+		    &argPtr->length);
+	    break;
+	case TCL_OO_ARG_OBJECT:
+	    argPtr->objectValue = Tcl_GetObjectFromObj(interp,
+		    argPtr->objPtr);
+	    if (argPtr->objectValue == NULL) {
+		goto badArgument;
+	    }
+	    break;
+	case TCL_OO_ARG_LIST:
+	    if (Tcl_ListObjGetElements(interp, argPtr->objPtr,
+		    &argPtr->length, &argPtr->elements) != TCL_OK) {
+		goto badArgument;
+	    }
+	    break;
+	}
+    }
+
+    result = amPtr->typePtr->callProc(amPtr->clientData, interp, context,
+	    objc, objv, args);
+    goto done;
+
+  badArgument:
+    Tcl_AppendObjToErrorInfo(interp, Tcl_ObjPrintf(
+	    "\n    (converting argument \"%s\")", specPtr->name));
+
+  done:
+    if (args != staticArgs) {
+	ckfree((char *) args);
+    }
+    return result;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * DeleteArgMethod, CloneArgMethod --
+ *
+ *	How to delete and clone methods of version 2 method types.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static void
+DeleteArgMethod(
+    ClientData clientData)
+{
+    ArgMethod *amPtr = clientData;
+    int i;
+
+    if (amPtr->typePtr->deleteProc != NULL) {
+	amPtr->typePtr->deleteProc(amPtr->clientData);
+    }
+    for (i=0 ; i<amPtr->numArgs ; i++) {
+	if (amPtr->defaults[i] != NULL) {
+	    Tcl_DecrRefCount(amPtr->defaults[i]);
+	}
+    }
+    if (amPtr->defaults != NULL) {
+	ckfree((char *) amPtr->defaults);
+    }
+    Tcl_DecrRefCount(amPtr->usageObj);
+    ckfree((char *) amPtr);
+}
+
+static int
+CloneArgMethod(
+    Tcl_Interp *interp,
+    ClientData clientData,
+    ClientData *newClientData)
+{
+    ArgMethod *amPtr = clientData;
+    ClientData realClientData = amPtr->clientData;
+
+    if (amPtr->typePtr->cloneProc != NULL
+	    && amPtr->typePtr->cloneProc(interp, amPtr->clientData,
+		    &realClientData) != TCL_OK) {
+	return TCL_ERROR;
+    }
+    *newClientData = NewArgMethod(amPtr->typePtr, realClientData);
+    return TCL_OK;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOMethodTypeName --
+ *
+ *	The name of the type of a method, as reported by introspection. This
+ *	is the name of the real type of methods of version 2 method types.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+const char *
+TclOOMethodTypeName(
+    Method *mPtr)
+{
+    if (mPtr->typePtr == &argMethodType) {
+	return ((ArgMethod *) mPtr->clientData)->typePtr->name;
+    }
+    return mPtr->typePtr->name;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1504,6 +1961,219 @@ TclOOGetFwdFromMethod(
     return NULL;
 }
 
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOMethodSize --
+ *
+ *	Computes the approximate number of bytes of memory used by a method,
+ *	including its body and the bytecode compiled from it where that is
+ *	known. Methods of types defined outside the core are only counted as
+ *	the basic method record, as their client data is opaque.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+Tcl_WideInt
+TclOOMethodSize(
+    Method *mPtr)
+{
+    Tcl_WideInt size;
+
+    if (mPtr == NULL) {
+	return 0;
+    }
+    size = sizeof(Method);
+    if (mPtr->typePtr == &procMethodType) {
+	ProcedureMethod *pmPtr = mPtr->clientData;
+	Proc *procPtr = pmPtr->procPtr;
+	Tcl_Obj *bodyPtr = procPtr->bodyPtr;
+	Object *declarerPtr = (mPtr->declaringClassPtr != NULL
+		? mPtr->declaringClassPtr->thisPtr : mPtr->declaringObjectPtr);
+
+	size += sizeof(ProcedureMethod) + sizeof(Proc)
+		+ sizeof(CompiledLocal) * procPtr->numCompiledLocals
+		+ sizeof(Tcl_Obj);
+	if (bodyPtr->bytes != NULL) {
+	    size += bodyPtr->length;
+	}
+	if (pmPtr->codePtr != NULL
+		&& bodyPtr->typePtr == declarerPtr->fPtr->byteCodeTypePtr
+		&& bodyPtr->internalRep.otherValuePtr == pmPtr->codePtr) {
+	    size += ((ByteCode *) pmPtr->codePtr)->structureSize;
+	}
+    } else if (mPtr->typePtr == &fwdMethodType) {
+	ForwardMethod *fwPtr = mPtr->clientData;
+
+	size += sizeof(ForwardMethod) + sizeof(Tcl_Obj);
+	if (fwPtr->prefixObj->bytes != NULL) {
+	    size += fwPtr->prefixObj->length;
+	}
+    } else if (mPtr->typePtr == &argMethodType) {
+	ArgMethod *amPtr = mPtr->clientData;
+
+	size += sizeof(ArgMethod) + sizeof(Tcl_Obj *) * amPtr->numArgs;
+    }
+    return size;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * TclOOPrecompileClasses --
+ *
+ *	Compiles the bodies of all the procedure-like methods (including
+ *	constructors and destructors) of the given classes, and optionally of
+ *	all their subclasses too, so that the cost of compilation is not paid
+ *	by the first call of each method. Statistics about the work done are
+ *	added to the structure pointed to by statsPtr, which the caller must
+ *	have initialized.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+int
+TclOOPrecompileClasses(
+    Tcl_Interp *interp,		/* Interpreter for compilation and error
+				 * reporting. */
+    int numClasses,		/* Number of classes to process. */
+    Class *const *classes,	/* The classes to process. */
+    int flags,			/* If PRECOMPILE_SUBCLASSES is set, the
+				 * subclasses of the classes are processed as
+				 * well. */
+    TclOOCompileStats *statsPtr)/* Where to accumulate the statistics. */
+{
+    Tcl_HashTable doneTable;
+    Class **stack, *clsPtr, *subPtr;
+    int i, isNew, depth = 0, stackSize = numClasses + 8;
+    int result = TCL_OK;
+    FOREACH_HASH_DECLS;
+    Method *mPtr;
+
+    /*
+     * Walk the class graph with an explicit stack, remembering which classes
+     * have been seen as multiple inheritance can make them reachable several
+     * times over.
+     */
+
+    Tcl_InitHashTable(&doneTable, TCL_ONE_WORD_KEYS);
+    stack = (Class **) ckalloc(sizeof(Class *) * stackSize);
+    for (i=numClasses-1 ; i>=0 ; i--) {
+	stack[depth++] = classes[i];
+    }
+    while (depth > 0) {
+	clsPtr = stack[--depth];
+	Tcl_CreateHashEntry(&doneTable, (char *) clsPtr, &isNew);
+	if (!isNew || clsPtr->thisPtr->command == NULL) {
+	    continue;
+	}
+
+	if (PrecompileMethod(interp, clsPtr->constructorPtr, clsPtr,
+		statsPtr) != TCL_OK
+		|| PrecompileMethod(interp, clsPtr->destructorPtr, clsPtr,
+		statsPtr) != TCL_OK) {
+	    result = TCL_ERROR;
+	    break;
+	}
+	FOREACH_HASH_VALUE(mPtr, &clsPtr->classMethods) {
+	    if (PrecompileMethod(interp, mPtr, clsPtr, statsPtr) != TCL_OK) {
+		result = TCL_ERROR;
+		break;
+	    }
+	}
+	if (result != TCL_OK) {
+	    break;
+	}
+
+	if (flags & PRECOMPILE_SUBCLASSES) {
+	    if (depth + clsPtr->subclasses.num > stackSize) {
+		stackSize = 2 * (depth + clsPtr->subclasses.num);
+		stack = (Class **) ckrealloc((char *) stack,
+			sizeof(Class *) * stackSize);
+	    }
+	    FOREACH(subPtr, clsPtr->subclasses) {
+		if (subPtr != NULL) {
+		    stack[depth++] = subPtr;
+		}
+	    }
+	}
+    }
+    ckfree((char *) stack);
+    Tcl_DeleteHashTable(&doneTable);
+    return result;
+}
+
+/*
+ * ----------------------------------------------------------------------
+ *
+ * PrecompileMethod --
+ *
+ *	Compiles the body of a single method, if it is procedure-like and is
+ *	not already compiled, and updates the statistics accordingly. The body
+ *	is compiled in the context of the namespace of the declaring class.
+ *
+ * ----------------------------------------------------------------------
+ */
+
+static int
+PrecompileMethod(
+    Tcl_Interp *interp,
+    Method *mPtr,
+    Class *clsPtr,
+    TclOOCompileStats *statsPtr)
+{
+    ProcedureMethod *pmPtr;
+    Proc *procPtr;
+    Command cmd, *oldCmdPtr;
+    Tcl_Time start, finish;
+    const char *namePtr;
+    ByteCode *codePtr;
+    int result;
+
+    if (mPtr == NULL || mPtr->typePtr != &procMethodType) {
+	return TCL_OK;
+    }
+    pmPtr = mPtr->clientData;
+    procPtr = pmPtr->procPtr;
+    statsPtr->numMethods++;
+
+    if (!IsBodyCompiled(interp, pmPtr, clsPtr->thisPtr->namespacePtr)) {
+	if (mPtr == clsPtr->constructorPtr) {
+	    namePtr = "<constructor>";
+	} else if (mPtr == clsPtr->destructorPtr) {
+	    namePtr = "<destructor>";
+	} else {
+	    namePtr = TclGetString(mPtr->namePtr);
+	}
+
+	/*
+	 * The compiler may look at the namespace of the procedure's command,
+	 * so supply a (bogus) one in the same way that a method call does.
+	 */
+
+	memset(&cmd, 0, sizeof(Command));
+	cmd.nsPtr = (Namespace *) clsPtr->thisPtr->namespacePtr;
+	oldCmdPtr = procPtr->cmdPtr;
+	procPtr->cmdPtr = &cmd;
+
+	Tcl_GetTime(&start);
+	result = CompileMethodBody(interp, pmPtr,
+		clsPtr->thisPtr->namespacePtr, namePtr);
+	Tcl_GetTime(&finish);
+	procPtr->cmdPtr = oldCmdPtr;
+	if (result != TCL_OK) {
+	    return result;
+	}
+	statsPtr->numCompiled++;
+	statsPtr->microseconds += (Tcl_WideInt) (finish.sec - start.sec)
+		* 1000000 + (finish.usec - start.usec);
+    }
+
+    codePtr = pmPtr->codePtr;
+    statsPtr->codeBytes += codePtr->structureSize;
+    return TCL_OK;
+}
+
 /*
  * ----------------------------------------------------------------------
  *
@@ -1614,6 +2284,17 @@ Tcl_MethodIsType(
 {
     Method *mPtr = (Method *) method;
 
+    if (mPtr->typePtr == &argMethodType) {
+	ArgMethod *amPtr = mPtr->clientData;
+
+	if ((const Tcl_MethodType *) amPtr->typePtr == typePtr) {
+	    if (clientDataPtr != NULL) {
+		*clientDataPtr = amPtr->clientData;
+	    }
+	    return 1;
+	}
+	return 0;
+    }
     if (mPtr->typePtr == typePtr) {
 	if (clientDataPtr != NULL) {
 	    *clientDataPtr = mPtr->clientData;
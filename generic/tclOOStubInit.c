@@ -30,6 +30,9 @@ static const TclOOIntStubs tclOOIntStubs = {
     TclOOClassSetFilters, /* 13 */
     TclOOObjectSetMixins, /* 14 */
     TclOOClassSetMixins, /* 15 */
+    TclOOPrecompileClasses, /* 16 */
+    TclOOProfileReport, /* 17 */
+    TclOOGetClassFootprint, /* 18 */
 };
 
 static const TclOOStubHooks tclOOStubHooks = {
@@ -68,6 +71,12 @@ const TclOOStubs tclOOStubs = {
     Tcl_ClassSetConstructor, /* 26 */
     Tcl_ClassSetDestructor, /* 27 */
     Tcl_GetObjectName, /* 28 */
+    Tcl_ClassIsSubclass, /* 29 */
+    Tcl_ObjectGetMethodNameMapper2, /* 30 */
+    Tcl_ObjectSetMethodNameMapper2, /* 31 */
+    Tcl_ObjectGetWeakRef, /* 32 */
+    Tcl_ObjectFromWeakRef, /* 33 */
+    Tcl_ClassForeachInstance, /* 34 */
 };
 
 /* !END!: Do not edit above this line. */